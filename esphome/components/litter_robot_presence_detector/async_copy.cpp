@@ -0,0 +1,92 @@
+#include "async_copy.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef LR_ASYNC_MEMCPY
+#include "esphome/core/log.h"
+#endif
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+#ifdef LR_ASYNC_MEMCPY
+static const char *const TAG = "litter_robot_presence_detector.async_copy";
+
+bool AsyncCopy::setup() {
+  this->done_ = xSemaphoreCreateBinary();
+  if (this->done_ == nullptr) {
+    return false;
+  }
+  async_memcpy_config_t config = ASYNC_MEMCPY_DEFAULT_CONFIG();
+  // the input buffer and the tensor arena both live in PSRAM
+  config.sram_trans_align = 4;
+  config.psram_trans_align = ASYNC_COPY_ALIGNMENT;
+  if (esp_async_memcpy_install(&config, &this->handle_) != ESP_OK) {
+    this->handle_ = nullptr;
+    return false;
+  }
+  return true;
+}
+
+bool AsyncCopy::on_done_(async_memcpy_handle_t handle, async_memcpy_event_t *event, void *arg) {
+  BaseType_t woken = pdFALSE;
+  xSemaphoreGiveFromISR(static_cast<AsyncCopy *>(arg)->done_, &woken);
+  return woken == pdTRUE;
+}
+
+bool AsyncCopy::start(void *dst, const void *src, size_t len) {
+  uint8_t *out = static_cast<uint8_t *>(dst);
+  const uint8_t *in = static_cast<const uint8_t *>(src);
+  const size_t offset = reinterpret_cast<uintptr_t>(out) % ASYNC_COPY_ALIGNMENT;
+  const size_t head = offset == 0 ? 0 : std::min(len, ASYNC_COPY_ALIGNMENT - offset);
+  const size_t body = (len - head) / ASYNC_COPY_ALIGNMENT * ASYNC_COPY_ALIGNMENT;
+  const char *reason = nullptr;
+  if (this->handle_ == nullptr) {
+    reason = "driver not installed";
+  } else if (reinterpret_cast<uintptr_t>(in) % ASYNC_COPY_ALIGNMENT != offset) {
+    reason = "source and destination at different cache line offsets";
+  } else if (body == 0) {
+    reason = "shorter than a cache line";
+  } else if (esp_async_memcpy(this->handle_, out + head, const_cast<uint8_t *>(in) + head, body, AsyncCopy::on_done_,
+                              this) != ESP_OK) {
+    reason = "rejected by the driver";
+  }
+
+  if (reason == nullptr) {
+    // the partial cache lines at either end do not overlap the lines the DMA engine writes back
+    memcpy(out, in, head);
+    memcpy(out + head + body, in + head + body, len - head - body);
+    this->pending_ = true;
+    this->dma_copies_++;
+    return true;
+  }
+  if (!this->fallback_logged_) {
+    ESP_LOGW(TAG, "async memcpy of %u bytes falls back to the CPU: %s", (unsigned) len, reason);
+    this->fallback_logged_ = true;
+  }
+  memcpy(dst, src, len);
+  this->cpu_copies_++;
+  return false;
+}
+
+void AsyncCopy::wait() {
+  if (this->pending_) {
+    xSemaphoreTake(this->done_, portMAX_DELAY);
+    this->pending_ = false;
+  }
+}
+#else
+bool AsyncCopy::setup() { return false; }
+
+bool AsyncCopy::start(void *dst, const void *src, size_t len) {
+  memcpy(dst, src, len);
+  this->cpu_copies_++;
+  return false;
+}
+
+void AsyncCopy::wait() {}
+#endif
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef USE_ESP32
+#include <esp_idf_version.h>
+#include <soc/soc_caps.h>
+#if SOC_ASYNC_MEMCPY_SUPPORTED && ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 2, 0)
+#define LR_ASYNC_MEMCPY 1
+#include <esp_async_memcpy.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#endif
+#endif
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+// PSRAM cache line, GDMA only moves whole lines of external memory
+static const size_t ASYNC_COPY_ALIGNMENT = 64;
+
+// One copy in flight on the GDMA async memcpy engine while the CPU keeps computing. Without the driver (host
+// builds, chips without GDMA, older ESP-IDF) or when the driver refuses a buffer, start() copies synchronously,
+// so callers always pair start() with wait() and never need a second code path. Only the cache line aligned middle
+// of a copy goes through DMA, the CPU copies the partial lines at either end, so src and dst must sit at the same
+// offset within a cache line for DMA to be used at all.
+class AsyncCopy {
+ public:
+  bool setup();
+  // false when the copy already happened synchronously
+  bool start(void *dst, const void *src, size_t len);
+  void wait();
+
+  uint32_t dma_copies() const { return this->dma_copies_; }
+  uint32_t cpu_copies() const { return this->cpu_copies_; }
+
+ protected:
+#ifdef LR_ASYNC_MEMCPY
+  static bool on_done_(async_memcpy_handle_t handle, async_memcpy_event_t *event, void *arg);
+
+  async_memcpy_handle_t handle_{nullptr};
+  SemaphoreHandle_t done_{nullptr};
+#endif
+  bool pending_{false};
+  bool fallback_logged_{false};
+  uint32_t dma_copies_{0};
+  uint32_t cpu_copies_{0};
+};
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
@@ -0,0 +1,62 @@
+#include "camera_recovery.h"
+
+#include <algorithm>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+static const uint32_t INITIAL_BACKOFF_MS = 1000;
+
+bool CameraRecovery::record_frame(uint32_t now) {
+  bool recovered = this->health_ == CameraHealth::RECOVERING;
+  if (recovered) {
+    this->last_recovery_ms_ = now - this->fault_start_;
+    this->recoveries_++;
+  }
+  this->health_ = CameraHealth::HEALTHY;
+  this->attempts_ = 0;
+  return recovered;
+}
+
+bool CameraRecovery::record_failure(uint32_t now) {
+  if (this->health_ == CameraHealth::HEALTHY) {
+    this->health_ = CameraHealth::FAILING;
+    this->fault_start_ = now;
+    return false;
+  }
+  if (this->health_ == CameraHealth::FAILING && now - this->fault_start_ >= this->timeout_) {
+    this->start_recovery_(now);
+    return true;
+  }
+  return false;
+}
+
+bool CameraRecovery::record_fault(uint32_t now) {
+  if (this->health_ == CameraHealth::RECOVERING) {
+    return false;
+  }
+  if (this->health_ == CameraHealth::HEALTHY) {
+    this->fault_start_ = now;
+  }
+  this->start_recovery_(now);
+  return true;
+}
+
+bool CameraRecovery::attempt_due(uint32_t now) {
+  if (this->health_ != CameraHealth::RECOVERING || (int32_t) (now - this->next_attempt_) < 0) {
+    return false;
+  }
+  this->attempts_++;
+  this->next_attempt_ = now + this->backoff_;
+  this->backoff_ = std::min(this->backoff_ * 2, this->max_backoff_);
+  return true;
+}
+
+void CameraRecovery::start_recovery_(uint32_t now) {
+  this->health_ = CameraHealth::RECOVERING;
+  this->backoff_ = INITIAL_BACKOFF_MS;
+  this->next_attempt_ = now;
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
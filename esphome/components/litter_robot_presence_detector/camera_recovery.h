@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+enum class CameraHealth : uint8_t { HEALTHY, FAILING, RECOVERING };
+
+// Decides when the camera needs re-initializing. A missed frame only makes the camera FAILING, single misses are
+// normal while the frame is still in flight. Once no frame arrived for `timeout` ms, or the camera component failed
+// outright, it is RECOVERING and attempts are spaced with exponential backoff until a frame arrives again.
+class CameraRecovery {
+ public:
+  void set_timeout(uint32_t timeout) { this->timeout_ = timeout; }
+  void set_max_backoff(uint32_t max_backoff) { this->max_backoff_ = max_backoff; }
+
+  // Returns true when the frame ends a recovery.
+  bool record_frame(uint32_t now);
+  // Returns true when the miss starts a recovery.
+  bool record_failure(uint32_t now);
+  bool record_fault(uint32_t now);
+  // Returns true when a recovery attempt is due; each such call counts as one attempt.
+  bool attempt_due(uint32_t now);
+
+  CameraHealth health() const { return this->health_; }
+  uint32_t attempts() const { return this->attempts_; }
+  uint32_t recoveries() const { return this->recoveries_; }
+  // first missed frame to first good frame of the last recovery
+  uint32_t last_recovery_ms() const { return this->last_recovery_ms_; }
+
+ protected:
+  void start_recovery_(uint32_t now);
+
+  uint32_t timeout_{10000};
+  uint32_t max_backoff_{60000};
+
+  CameraHealth health_{CameraHealth::HEALTHY};
+  uint32_t fault_start_{0};
+  uint32_t next_attempt_{0};
+  uint32_t backoff_{0};
+  uint32_t attempts_{0};
+  uint32_t recoveries_{0};
+  uint32_t last_recovery_ms_{0};
+};
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
@@ -0,0 +1,153 @@
+#include "cat_enrollment.h"
+
+#include <cmath>
+#include <cstring>
+
+#ifdef USE_ESP32
+#include "esphome/core/defines.h"
+#endif
+#ifdef USE_ENROLLMENT
+#include <dsps_dotprod.h>
+#endif
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+static int32_t dot_product_s16_scalar(const int16_t *a, const int16_t *b, size_t len) {
+  int32_t acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+  size_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    acc0 += a[i] * b[i];
+    acc1 += a[i + 1] * b[i + 1];
+    acc2 += a[i + 2] * b[i + 2];
+    acc3 += a[i + 3] * b[i + 3];
+  }
+  for (; i < len; i++) {
+    acc0 += a[i] * b[i];
+  }
+  return acc0 + acc1 + acc2 + acc3;
+}
+
+#ifdef USE_ENROLLMENT
+int32_t dot_product_s16(const int16_t *a, const int16_t *b, size_t len) {
+  // dsps_dotprod_s16 returns the sum shifted right by 15 - shift as int16, so drop just enough low bits for len
+  // full scale products (and the rounding term) to fit; cosine similarity does not miss them
+  static const int64_t MAX_PRODUCT = 255 * 255;
+  int drop = 0;
+  while (((static_cast<int64_t>(len) * MAX_PRODUCT + (1 << drop)) >> drop) > INT16_MAX) {
+    drop++;
+  }
+  int16_t result;
+  if (dsps_dotprod_s16(a, b, &result, static_cast<int>(len), static_cast<int8_t>(15 - drop)) != ESP_OK) {
+    return dot_product_s16_scalar(a, b, len);
+  }
+  return static_cast<int32_t>(result) * (1 << drop);
+}
+#else
+int32_t dot_product_s16(const int16_t *a, const int16_t *b, size_t len) { return dot_product_s16_scalar(a, b, len); }
+#endif
+
+void CatEnrollment::center_(const int8_t *embedding, int32_t zero_point) {
+  for (size_t i = 0; i < this->store_.dim; i++) {
+    // no clamping: a post-ReLU embedding with zero point -128 would saturate at 127 from its second step on
+    this->centered_[i] = static_cast<int16_t>(embedding[i] - zero_point);
+  }
+}
+
+void CatEnrollment::start(const char *name, uint32_t frames) {
+  strncpy(this->pending_name_, name, CAT_NAME_SIZE - 1);
+  this->pending_name_[CAT_NAME_SIZE - 1] = '\0';
+  memset(this->sums_, 0, sizeof(this->sums_));
+  this->frames_remaining_ = frames;
+  this->frames_collected_ = 0;
+}
+
+bool CatEnrollment::collect(const int8_t *embedding, int32_t zero_point, bool *evicted) {
+  if (evicted != nullptr) {
+    *evicted = false;
+  }
+  if (this->frames_remaining_ == 0) {
+    return false;
+  }
+
+  this->center_(embedding, zero_point);
+  for (size_t i = 0; i < this->store_.dim; i++) {
+    this->sums_[i] += this->centered_[i];
+  }
+  this->frames_collected_++;
+  if (--this->frames_remaining_ > 0) {
+    return false;
+  }
+
+  size_t slot = this->store_.count;
+  for (size_t i = 0; i < this->store_.count; i++) {
+    if (strncmp(this->store_.names[i], this->pending_name_, CAT_NAME_SIZE) == 0) {
+      slot = i;
+      break;
+    }
+  }
+  if (slot == MAX_ENROLLED_CATS) {
+    // full, the oldest prototype makes room
+    memmove(this->store_.names[0], this->store_.names[1], (MAX_ENROLLED_CATS - 1) * CAT_NAME_SIZE);
+    memmove(this->store_.vectors[0], this->store_.vectors[1],
+            (MAX_ENROLLED_CATS - 1) * sizeof(this->store_.vectors[0]));
+    slot = MAX_ENROLLED_CATS - 1;
+    if (evicted != nullptr) {
+      *evicted = true;
+    }
+  } else if (slot == this->store_.count) {
+    this->store_.count++;
+  }
+
+  memcpy(this->store_.names[slot], this->pending_name_, CAT_NAME_SIZE);
+  for (size_t i = 0; i < this->store_.dim; i++) {
+    this->store_.vectors[slot][i] = this->sums_[i] / static_cast<int32_t>(this->frames_collected_);
+  }
+  this->update_norms();
+  return true;
+}
+
+int CatEnrollment::classify(const int8_t *embedding, int32_t zero_point, float *similarity) const {
+  if (this->store_.count == 0) {
+    return -1;
+  }
+
+  int16_t centered[MAX_EMBEDDING_DIM];
+  for (size_t i = 0; i < this->store_.dim; i++) {
+    centered[i] = static_cast<int16_t>(embedding[i] - zero_point);
+  }
+  const int32_t norm = dot_product_s16(centered, centered, this->store_.dim);
+
+  int best = 0;
+  float best_similarity = -2.0f;
+  for (size_t i = 0; i < this->store_.count; i++) {
+    const int32_t dot = dot_product_s16(centered, this->store_.vectors[i], this->store_.dim);
+    const float denominator = sqrtf(static_cast<float>(norm) * static_cast<float>(this->norms_[i]));
+    const float cosine = denominator > 0.0f ? dot / denominator : 0.0f;
+    if (cosine > best_similarity) {
+      best_similarity = cosine;
+      best = i;
+    }
+  }
+
+  if (similarity != nullptr) {
+    *similarity = best_similarity;
+  }
+  return best;
+}
+
+void CatEnrollment::clear() {
+  uint8_t dim = this->store_.dim;
+  memset(&this->store_, 0, sizeof(this->store_));
+  this->store_.dim = dim;
+  this->frames_remaining_ = 0;
+}
+
+void CatEnrollment::update_norms() {
+  for (size_t i = 0; i < this->store_.count; i++) {
+    this->norms_[i] = dot_product_s16(this->store_.vectors[i], this->store_.vectors[i], this->store_.dim);
+  }
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
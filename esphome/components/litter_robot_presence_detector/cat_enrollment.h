@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+static const size_t MAX_ENROLLED_CATS = 4;
+static const size_t MAX_EMBEDDING_DIM = 128;
+static const size_t CAT_NAME_SIZE = 16;
+
+// Flat layout so it can be stored as one preference (NVS blob). Widest member first, so it needs no padding and the
+// vectors stay aligned for dot_product_s16().
+struct PrototypeStore {
+  // zero-point corrected, so an 8-bit embedding spans -255..255
+  int16_t vectors[MAX_ENROLLED_CATS][MAX_EMBEDDING_DIM];
+  char names[MAX_ENROLLED_CATS][CAT_NAME_SIZE];
+  uint8_t count;
+  uint8_t dim;
+};
+
+// int16 dot product. With enrollment on the device it runs esp-dsp's dsps_dotprod_s16 (SIMD on the ESP32-S3), which
+// returns int16, so the low bits a full scale sum would overflow are dropped. Host builds keep a scalar loop with
+// four int32 accumulators; 128 products of 255 * 255 stay well inside int32.
+int32_t dot_product_s16(const int16_t *a, const int16_t *b, size_t len);
+
+// Nearest-centroid head on top of the model's penultimate embedding. Prototypes are the mean of a few zero-point
+// corrected embeddings captured while a cat sits in the box, compared by cosine similarity.
+class CatEnrollment {
+ public:
+  void set_dim(uint8_t dim) { this->store_.dim = dim; }
+  uint8_t dim() const { return this->store_.dim; }
+  size_t size() const { return this->store_.count; }
+  const char *name(size_t index) const { return this->store_.names[index]; }
+
+  // Starts collecting `frames` embeddings for `name`, replacing an existing prototype with the same name.
+  void start(const char *name, uint32_t frames);
+  bool is_collecting() const { return this->frames_remaining_ > 0; }
+  // Accumulates one embedding. Returns true when the prototype was completed and the store should be saved.
+  // `evicted` is set when the store was full and the oldest prototype made room, which moves every later prototype
+  // down one index.
+  bool collect(const int8_t *embedding, int32_t zero_point, bool *evicted = nullptr);
+  // Returns the index of the closest prototype, or -1 when nothing is enrolled.
+  int classify(const int8_t *embedding, int32_t zero_point, float *similarity) const;
+  void clear();
+
+  PrototypeStore &store() { return this->store_; }
+  // recomputes the cached prototype norms, call after loading the store
+  void update_norms();
+
+ protected:
+  PrototypeStore store_{};
+  int32_t norms_[MAX_ENROLLED_CATS]{};
+  int32_t sums_[MAX_EMBEDDING_DIM]{};
+  int16_t centered_[MAX_EMBEDDING_DIM]{};
+  char pending_name_[CAT_NAME_SIZE]{};
+  uint32_t frames_remaining_{0};
+  uint32_t frames_collected_{0};
+
+  void center_(const int8_t *embedding, int32_t zero_point);
+};
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
@@ -0,0 +1,30 @@
+#pragma once
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+// Input rows [input_begin, input_end) an output row band of a Conv2D reads, and the top padding that keeps every
+// tap of the band where the full-size call has it. Rows below the slice are bottom padding, as in the full call.
+struct ConvBandRows {
+  int input_begin;
+  int input_end;
+  int pad_top;
+};
+
+inline ConvBandRows plan_conv_band(int row_begin, int row_end, int input_height, int filter_height, int stride_height,
+                                   int dilation_height, int pad_top) {
+  const int first_row = row_begin * stride_height - pad_top;
+  const int last_row = (row_end - 1) * stride_height - pad_top + (filter_height - 1) * dilation_height + 1;
+  ConvBandRows rows;
+  rows.input_begin = first_row < 0 ? 0 : first_row;
+  rows.input_end = last_row > input_height ? input_height : last_row;
+  if (rows.input_end < rows.input_begin) {
+    // band only reads bottom padding
+    rows.input_end = rows.input_begin;
+  }
+  rows.pad_top = rows.input_begin - first_row;
+  return rows;
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
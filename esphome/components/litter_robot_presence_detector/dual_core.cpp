@@ -0,0 +1,66 @@
+#ifdef USE_ESP32
+#include "dual_core.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+static const char *const TAG = "litter_robot_presence_detector.dual_core";
+static const uint32_t WORKER_STACK_SIZE = 4096;
+
+DualCoreWorker *global_dual_core_worker = nullptr;
+
+bool DualCoreWorker::start() {
+  if (this->task_ != nullptr) {
+    return true;
+  }
+  if (portNUM_PROCESSORS < 2) {
+    ESP_LOGW(TAG, "single core chip, running kernels on one core");
+    return false;
+  }
+
+  this->start_ = xSemaphoreCreateBinary();
+  this->done_ = xSemaphoreCreateBinary();
+  if (this->start_ == nullptr || this->done_ == nullptr) {
+    ESP_LOGE(TAG, "failed to create worker semaphores");
+    return false;
+  }
+
+  BaseType_t other_core = xPortGetCoreID() == 0 ? 1 : 0;
+  if (xTaskCreatePinnedToCore(DualCoreWorker::worker_task_, "lr_worker", WORKER_STACK_SIZE, this,
+                              uxTaskPriorityGet(nullptr), &this->task_, other_core) != pdPASS) {
+    ESP_LOGE(TAG, "failed to create worker task");
+    this->task_ = nullptr;
+    return false;
+  }
+
+  ESP_LOGD(TAG, "worker task pinned to core %d", other_core);
+  return true;
+}
+
+void DualCoreWorker::run(DualCoreFn fn, void *local_arg, void *remote_arg) {
+  if (this->task_ == nullptr) {
+    fn(local_arg);
+    fn(remote_arg);
+    return;
+  }
+
+  this->fn_ = fn;
+  this->arg_ = remote_arg;
+  xSemaphoreGive(this->start_);
+  fn(local_arg);
+  xSemaphoreTake(this->done_, portMAX_DELAY);
+}
+
+void DualCoreWorker::worker_task_(void *param) {
+  auto *worker = static_cast<DualCoreWorker *>(param);
+  while (true) {
+    xSemaphoreTake(worker->start_, portMAX_DELAY);
+    worker->fn_(worker->arg_);
+    xSemaphoreGive(worker->done_);
+  }
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+
+#ifdef USE_ESP32
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+using DualCoreFn = void (*)(void *arg);
+
+// Worker task pinned to the core that is not running the caller. A split is handed over with one semaphore give
+// in each direction, so kernels can fan out once per op instead of locking per tile.
+class DualCoreWorker {
+ public:
+  bool start();
+  bool is_running() const { return this->task_ != nullptr; }
+  TaskHandle_t task() const { return this->task_; }
+
+  // Runs fn(remote_arg) on the other core and fn(local_arg) on the calling core. Returns once both have finished.
+  void run(DualCoreFn fn, void *local_arg, void *remote_arg);
+
+ protected:
+  static void worker_task_(void *param);
+
+  TaskHandle_t task_{nullptr};
+  SemaphoreHandle_t start_{nullptr};
+  SemaphoreHandle_t done_{nullptr};
+  DualCoreFn fn_{nullptr};
+  void *arg_{nullptr};
+};
+
+extern DualCoreWorker *global_dual_core_worker;
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+
+#endif
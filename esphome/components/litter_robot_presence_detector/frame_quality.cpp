@@ -0,0 +1,74 @@
+#include "frame_quality.h"
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+static const int SAMPLE_STEP = 4;
+static const int HISTOGRAM_BINS = 16;
+// luma below this (the two lowest histogram bins) counts as dark
+static const int DARK_BINS = 2;
+static const uint8_t SATURATED_LEVEL = 250;
+
+static inline int rgb_to_luma(const uint8_t *rgb) { return (rgb[0] * 77 + rgb[1] * 150 + rgb[2] * 29) >> 8; }
+
+void measure_frame_quality(const uint8_t *rgb, int width, int height, FrameQuality *quality) {
+  uint32_t histogram[HISTOGRAM_BINS] = {0};
+  uint32_t samples = 0;
+  uint32_t saturated = 0;
+  uint32_t luma_sum = 0;
+  uint32_t gradient_sum = 0;
+  uint32_t gradient_samples = 0;
+
+  const int stride = width * 3;
+  for (int y = 0; y < height; y += SAMPLE_STEP) {
+    const uint8_t *row = rgb + y * stride;
+    for (int x = 0; x < width; x += SAMPLE_STEP) {
+      const uint8_t *pixel = row + x * 3;
+      int luma = rgb_to_luma(pixel);
+      histogram[luma * HISTOGRAM_BINS / 256]++;
+      luma_sum += luma;
+      samples++;
+      if (pixel[0] >= SATURATED_LEVEL || pixel[1] >= SATURATED_LEVEL || pixel[2] >= SATURATED_LEVEL) {
+        saturated++;
+      }
+
+      if (x + 1 < width && y + 1 < height) {
+        int right = rgb_to_luma(pixel + 3);
+        int below = rgb_to_luma(pixel + stride);
+        gradient_sum += (right > luma ? right - luma : luma - right) + (below > luma ? below - luma : luma - below);
+        gradient_samples++;
+      }
+    }
+  }
+
+  if (samples == 0) {
+    *quality = {0, 100, 0, 0};
+    return;
+  }
+
+  uint32_t dark = 0;
+  for (int i = 0; i < DARK_BINS; i++) {
+    dark += histogram[i];
+  }
+
+  quality->mean_luma = luma_sum / samples;
+  quality->dark_percent = dark * 100 / samples;
+  quality->saturated_percent = saturated * 100 / samples;
+  quality->gradient = gradient_samples == 0 ? 0 : gradient_sum / gradient_samples;
+}
+
+const char *FrameQualityGate::check(const FrameQuality &quality) const {
+  if (quality.dark_percent > this->max_dark_percent_) {
+    return "too dark";
+  }
+  if (quality.saturated_percent > this->max_saturated_percent_) {
+    return "overexposed";
+  }
+  if (quality.gradient < this->min_gradient_) {
+    return "blurred";
+  }
+  return nullptr;
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+struct FrameQuality {
+  uint8_t mean_luma;
+  uint8_t dark_percent;       // sampled pixels with luma below the dark level
+  uint8_t saturated_percent;  // sampled pixels with any channel clipped
+  uint16_t gradient;          // mean absolute luma step to the right and below, a sharpness estimate
+};
+
+// Samples a decoded RGB888 frame on a sparse grid (every 4th pixel in both directions), building a 16-bin luma
+// histogram for the dark/saturated shares and a gradient-energy estimate for blur.
+void measure_frame_quality(const uint8_t *rgb, int width, int height, FrameQuality *quality);
+
+// Rejects frames taken while lights switch or auto exposure settles, so they never vote in decide_state().
+class FrameQualityGate {
+ public:
+  void set_max_dark_percent(uint8_t max_dark_percent) { this->max_dark_percent_ = max_dark_percent; }
+  void set_max_saturated_percent(uint8_t max_saturated_percent) {
+    this->max_saturated_percent_ = max_saturated_percent;
+  }
+  void set_min_gradient(uint16_t min_gradient) { this->min_gradient_ = min_gradient; }
+
+  // Returns nullptr for usable frames, otherwise the reason the frame was rejected.
+  const char *check(const FrameQuality &quality) const;
+
+ protected:
+  uint8_t max_dark_percent_{80};
+  uint8_t max_saturated_percent_{30};
+  uint16_t min_gradient_{2};
+};
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
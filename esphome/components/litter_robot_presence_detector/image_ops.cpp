@@ -0,0 +1,139 @@
+#include "image_ops.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+bool crop_resize_rgb888(const uint8_t *src, int src_width, int x, int y, int width, int height, uint8_t *dst,
+                        int dst_width, int dst_height) {
+  if (dst_width <= 0 || dst_width > MAX_CROP_RESIZE_WIDTH) {
+    return false;
+  }
+  // source offset of each output column, computed once instead of per row
+  uint16_t src_offsets[MAX_CROP_RESIZE_WIDTH];
+  for (int dx = 0; dx < dst_width; dx++) {
+    src_offsets[dx] = (x + dx * width / dst_width) * 3;
+  }
+
+  for (int dy = 0; dy < dst_height; dy++) {
+    const uint8_t *src_row = src + (size_t) (y + dy * height / dst_height) * src_width * 3;
+    if (width == dst_width) {
+      memcpy(dst, src_row + x * 3, dst_width * 3);
+      dst += dst_width * 3;
+      continue;
+    }
+    for (int dx = 0; dx < dst_width; dx++) {
+      const uint8_t *pixel = src_row + src_offsets[dx];
+      *dst++ = pixel[0];
+      *dst++ = pixel[1];
+      *dst++ = pixel[2];
+    }
+  }
+  return true;
+}
+
+static const int TILE_SIZE = 16;
+
+void OrientedCopy::configure(int src_width, int src_height, int dst_width, int dst_height) {
+  if (src_width == this->src_width_ && src_height == this->src_height_ && dst_width == this->dst_width_ &&
+      dst_height == this->dst_height_) {
+    return;
+  }
+  this->src_width_ = src_width;
+  this->src_height_ = src_height;
+  this->dst_width_ = dst_width;
+  this->dst_height_ = dst_height;
+
+  const bool transposed = this->rotation_ == 90 || this->rotation_ == 270;
+  // size of the upright image the output is sampled from
+  const int upright_width = transposed ? src_height : src_width;
+  const int upright_height = transposed ? src_width : src_height;
+  const uint32_t stride = src_width * 3;
+
+  // the upright image keeps its aspect ratio, centred between black bars when it differs from the output's
+  this->content_width_ = dst_width;
+  this->content_height_ = dst_height;
+  if (upright_width * dst_height > upright_height * dst_width) {
+    this->content_height_ = upright_height * dst_width / upright_width;
+  } else {
+    this->content_width_ = upright_width * dst_height / upright_height;
+  }
+  this->content_x_ = (dst_width - this->content_width_) / 2;
+  this->content_y_ = (dst_height - this->content_height_) / 2;
+  dst_width = this->content_width_;
+  dst_height = this->content_height_;
+
+  // source offset = row_offsets_[dy] + column_offsets_[dx]; with a transposition the output row picks the source
+  // column and the output column the source row
+  this->column_offsets_.resize(dst_width);
+  for (int dx = 0; dx < dst_width; dx++) {
+    int ux = dx * upright_width / dst_width;
+    if (this->mirror_) {
+      ux = upright_width - 1 - ux;
+    }
+    switch (this->rotation_) {
+      case 90:
+        this->column_offsets_[dx] = (src_height - 1 - ux) * stride;
+        break;
+      case 180:
+        this->column_offsets_[dx] = (src_width - 1 - ux) * 3;
+        break;
+      case 270:
+        this->column_offsets_[dx] = ux * stride;
+        break;
+      default:
+        this->column_offsets_[dx] = ux * 3;
+        break;
+    }
+  }
+
+  this->row_offsets_.resize(dst_height);
+  for (int dy = 0; dy < dst_height; dy++) {
+    int uy = dy * upright_height / dst_height;
+    switch (this->rotation_) {
+      case 90:
+        this->row_offsets_[dy] = uy * 3;
+        break;
+      case 180:
+        this->row_offsets_[dy] = (src_height - 1 - uy) * stride;
+        break;
+      case 270:
+        this->row_offsets_[dy] = (src_width - 1 - uy) * 3;
+        break;
+      default:
+        this->row_offsets_[dy] = uy * stride;
+        break;
+    }
+  }
+}
+
+void OrientedCopy::copy(const uint8_t *src, uint8_t *dst) const {
+  const uint32_t *rows = this->row_offsets_.data();
+  const uint32_t *columns = this->column_offsets_.data();
+  const size_t dst_stride = (size_t) this->dst_width_ * 3;
+  if (this->content_width_ != this->dst_width_ || this->content_height_ != this->dst_height_) {
+    memset(dst, 0, dst_stride * this->dst_height_);
+    dst += this->content_y_ * dst_stride + this->content_x_ * 3;
+  }
+  for (int tile_y = 0; tile_y < this->content_height_; tile_y += TILE_SIZE) {
+    const int end_y = std::min(tile_y + TILE_SIZE, this->content_height_);
+    for (int tile_x = 0; tile_x < this->content_width_; tile_x += TILE_SIZE) {
+      const int end_x = std::min(tile_x + TILE_SIZE, this->content_width_);
+      for (int dy = tile_y; dy < end_y; dy++) {
+        const uint8_t *src_row = src + rows[dy];
+        uint8_t *out = dst + dy * dst_stride + tile_x * 3;
+        for (int dx = tile_x; dx < end_x; dx++) {
+          const uint8_t *pixel = src_row + columns[dx];
+          *out++ = pixel[0];
+          *out++ = pixel[1];
+          *out++ = pixel[2];
+        }
+      }
+    }
+  }
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
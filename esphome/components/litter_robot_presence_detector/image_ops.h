@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+// largest dst_width crop_resize_rgb888() takes, its column map lives on the stack
+static const int MAX_CROP_RESIZE_WIDTH = 320;
+
+// Nearest-neighbour scales the (x, y, width, height) window of an RGB888 image to dst_width x dst_height. Returns
+// false without writing anything when dst_width is not in 1..MAX_CROP_RESIZE_WIDTH.
+bool crop_resize_rgb888(const uint8_t *src, int src_width, int x, int y, int width, int height, uint8_t *dst,
+                        int dst_width, int dst_height);
+
+// Copies a decoded RGB888 frame into the model input while undoing the camera mounting: rotation is clockwise and
+// the mirror flips the rotated image left to right. A 90/270 degree turn of a landscape frame into a landscape input
+// is letterboxed: the upright image is scaled to fit and centred between black bars instead of stretched. The offset
+// tables make every output pixel one lookup, and the copy walks the output in tiles so the column reads of a
+// transposition stay within a few cache lines.
+class OrientedCopy {
+ public:
+  void set_rotation(int rotation) { this->rotation_ = rotation; }
+  void set_mirror(bool mirror) { this->mirror_ = mirror; }
+  int rotation() const { return this->rotation_; }
+  bool mirror() const { return this->mirror_; }
+
+  // rebuilds the offset tables when the frame or input size changed
+  void configure(int src_width, int src_height, int dst_width, int dst_height);
+  void copy(const uint8_t *src, uint8_t *dst) const;
+
+ protected:
+  int rotation_{0};
+  bool mirror_{false};
+  int src_width_{0};
+  int src_height_{0};
+  int dst_width_{0};
+  int dst_height_{0};
+  // where the upright image lands in the output, the rest are letterbox bars
+  int content_x_{0};
+  int content_y_{0};
+  int content_width_{0};
+  int content_height_{0};
+  std::vector<uint32_t> row_offsets_;
+  std::vector<uint32_t> column_offsets_;
+};
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
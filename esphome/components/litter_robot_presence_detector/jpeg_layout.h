@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+static const uint8_t MARKER_SOF0 = 0xC0;
+static const uint8_t MARKER_SOF1 = 0xC1;
+static const uint8_t MARKER_SOF2 = 0xC2;
+static const uint8_t MARKER_RST0 = 0xD0;
+static const uint8_t MARKER_RST7 = 0xD7;
+static const uint8_t MARKER_SOI = 0xD8;
+static const uint8_t MARKER_EOI = 0xD9;
+static const uint8_t MARKER_SOS = 0xDA;
+static const uint8_t MARKER_DRI = 0xDD;
+
+struct JpegLayout {
+  uint16_t width{0};
+  uint16_t height{0};
+  uint8_t mcu_width{8};
+  uint8_t mcu_height{8};
+  uint16_t restart_interval{0};
+  size_t sof_height_offset{0};  // offset of the 16-bit frame height inside the SOF segment
+  size_t scan_offset{0};        // first byte of entropy-coded data
+};
+
+// Where a baseline JPEG is cut in two, and the sizes of the two standalone streams.
+struct JpegSplit {
+  uint32_t split_row{0};     // first MCU row of the bottom half, 0 when no restart marker starts a row
+  uint32_t split_marker{0};  // 1-based count of the RST marker that opens the bottom half
+  size_t split_pos{0};       // offset of that marker, 0 when the scan has fewer markers
+  uint16_t top_height{0};
+  uint16_t bottom_height{0};
+  size_t top_len{0};
+  size_t bottom_len{0};
+};
+
+static inline uint16_t read_be16(const uint8_t *p) { return (p[0] << 8) | p[1]; }
+
+static inline bool is_rst_marker(const uint8_t *p) {
+  return p[0] == 0xFF && p[1] >= MARKER_RST0 && p[1] <= MARKER_RST7;
+}
+
+// Walks the marker segments up to SOS. Returns false for streams tjpgd cannot decode (progressive, truncated).
+inline bool parse_jpeg_layout(const uint8_t *data, size_t len, JpegLayout *layout) {
+  if (len < 4 || data[0] != 0xFF || data[1] != MARKER_SOI) {
+    return false;
+  }
+
+  size_t pos = 2;
+  bool has_frame = false;
+  while (pos + 4 <= len) {
+    if (data[pos] != 0xFF) {
+      return false;
+    }
+    uint8_t marker = data[pos + 1];
+    if (marker == 0xFF) {
+      // fill byte
+      pos++;
+      continue;
+    }
+
+    uint16_t segment_len = read_be16(data + pos + 2);
+    if (pos + 2 + segment_len > len) {
+      return false;
+    }
+    const uint8_t *segment = data + pos + 4;
+
+    switch (marker) {
+      case MARKER_SOF0:
+      case MARKER_SOF1:
+        if (segment_len < 11) {
+          return false;
+        }
+        layout->sof_height_offset = pos + 5;
+        layout->height = read_be16(segment + 1);
+        layout->width = read_be16(segment + 3);
+        // sampling factors of the first (luma) component set the MCU size
+        layout->mcu_width = (segment[7] >> 4) * 8;
+        layout->mcu_height = (segment[7] & 0x0F) * 8;
+        has_frame = true;
+        break;
+      case MARKER_SOF2:
+        return false;
+      case MARKER_DRI:
+        layout->restart_interval = read_be16(segment);
+        break;
+      case MARKER_SOS:
+        layout->scan_offset = pos + 2 + segment_len;
+        return has_frame && layout->mcu_width != 0 && layout->mcu_height != 0;
+      default:
+        break;
+    }
+    pos += 2 + segment_len;
+  }
+  return false;
+}
+
+// Picks the MCU row closest to the middle that starts right after a restart marker and finds that marker in the
+// scan. Returns false without a restart interval (no DRI), when no marker lands on a row boundary, or when the scan
+// runs out of markers; the caller then decodes the frame as one stream.
+inline bool plan_jpeg_split(const uint8_t *data, size_t len, const JpegLayout &layout, JpegSplit *split) {
+  *split = JpegSplit{};
+  if (layout.restart_interval == 0) {
+    return false;
+  }
+  const uint32_t mcus_per_row = (layout.width + layout.mcu_width - 1) / layout.mcu_width;
+  const uint32_t mcu_rows = (layout.height + layout.mcu_height - 1) / layout.mcu_height;
+
+  for (uint32_t offset = 0; offset < mcu_rows / 2 && split->split_row == 0; offset++) {
+    const uint32_t candidates[2] = {mcu_rows / 2 - offset, mcu_rows / 2 + offset};
+    for (uint32_t row : candidates) {
+      if (row > 0 && row < mcu_rows && (row * mcus_per_row) % layout.restart_interval == 0) {
+        split->split_row = row;
+        break;
+      }
+    }
+  }
+  if (split->split_row == 0) {
+    return false;
+  }
+
+  split->split_marker = (split->split_row * mcus_per_row) / layout.restart_interval;
+  uint32_t markers_seen = 0;
+  for (size_t i = layout.scan_offset; i + 1 < len; i++) {
+    if (is_rst_marker(data + i)) {
+      if (++markers_seen == split->split_marker) {
+        split->split_pos = i;
+        break;
+      }
+      i++;
+    }
+  }
+  if (split->split_pos == 0) {
+    return false;
+  }
+
+  // top stream: headers + scan data up to the marker + EOI
+  // bottom stream: headers + scan data after the marker (already ends with EOI)
+  split->top_height = split->split_row * layout.mcu_height;
+  split->bottom_height = layout.height - split->top_height;
+  split->top_len = split->split_pos + 2;
+  split->bottom_len = layout.scan_offset + (len - split->split_pos - 2);
+  return true;
+}
+
+// Writes the two standalone streams of a split: the headers are copied with the frame height patched, and the bottom
+// half's RST markers are renumbered to start from RST0. `top` needs split.top_len bytes, `bottom` split.bottom_len.
+inline void write_jpeg_halves(const uint8_t *data, size_t len, const JpegLayout &layout, const JpegSplit &split,
+                              uint8_t *top, uint8_t *bottom) {
+  memcpy(top, data, split.split_pos);
+  top[layout.sof_height_offset] = split.top_height >> 8;
+  top[layout.sof_height_offset + 1] = split.top_height & 0xFF;
+  top[split.split_pos] = 0xFF;
+  top[split.split_pos + 1] = MARKER_EOI;
+
+  const size_t header_len = layout.scan_offset;
+  memcpy(bottom, data, header_len);
+  bottom[layout.sof_height_offset] = split.bottom_height >> 8;
+  bottom[layout.sof_height_offset + 1] = split.bottom_height & 0xFF;
+  memcpy(bottom + header_len, data + split.split_pos + 2, len - split.split_pos - 2);
+  // tjpgd expects RST markers in sequence from RST0
+  for (size_t i = header_len; i + 1 < split.bottom_len; i++) {
+    if (is_rst_marker(bottom + i)) {
+      bottom[i + 1] = MARKER_RST0 + ((bottom[i + 1] - MARKER_RST0 - split.split_marker) & 7);
+      i++;
+    }
+  }
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
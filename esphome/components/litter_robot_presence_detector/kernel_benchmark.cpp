@@ -0,0 +1,190 @@
+#ifdef USE_ESP32
+#include "kernel_benchmark.h"
+#include "frame_quality.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+
+#include "jpeg_decoder.h"
+#include <esp_cpu.h>
+#include <esp_rom_sys.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+static const char *const TAG = "litter_robot_presence_detector.bench";
+static const int ITERATIONS = 20;
+// a kernel slower than this still runs once per step()
+static const uint32_t STEP_SLICE_MS = 20;
+
+enum Kernel {
+  // 1/1 last, it leaves the full resolution frame for crop resize
+  KERNEL_DECODE_1_8,
+  KERNEL_DECODE_1_4,
+  KERNEL_DECODE_1_2,
+  KERNEL_DECODE_1_1,
+  KERNEL_CROP_RESIZE,
+  KERNEL_ORIENTED_COPY_0,
+  KERNEL_ORIENTED_COPY_90,
+  KERNEL_ORIENTED_COPY_180,
+  KERNEL_INPUT_COPY,
+  KERNEL_FRAME_QUALITY,
+  KERNEL_PREVIEW_CHANGE,
+  KERNEL_COUNT,
+};
+
+static const char *const KERNEL_NAMES[KERNEL_COUNT] = {
+    "jpeg decode 1/8",  "jpeg decode 1/4",   "jpeg decode 1/2", "jpeg decode 1/1", "crop resize",    "oriented copy 0",
+    "oriented copy 90", "oriented copy 180", "input copy",      "frame quality",   "preview change",
+};
+
+bool KernelBenchmark::start(const camera_fb_t *rb, int input_width, int input_height) {
+  this->release_();
+  this->jpeg_size_ = rb->len;
+  this->frame_size_ = rb->width * rb->height * 3;
+  this->input_size_ = input_width * input_height * 3;
+  ExternalRAMAllocator<uint8_t> allocator(ExternalRAMAllocator<uint8_t>::ALLOW_FAILURE);
+  this->jpeg_ = allocator.allocate(this->jpeg_size_);
+  this->frame_ = allocator.allocate(this->frame_size_);
+  this->input_ = allocator.allocate(this->input_size_);
+  this->output_ = allocator.allocate(this->input_size_);
+  if (this->jpeg_ == nullptr || this->frame_ == nullptr || this->input_ == nullptr || this->output_ == nullptr) {
+    ESP_LOGE(TAG, "Could not allocate benchmark buffers.");
+    this->release_();
+    return false;
+  }
+  memcpy(this->jpeg_, rb->buf, rb->len);
+  // random input for the kernels that run before crop resize fills it
+  for (size_t i = 0; i < this->input_size_; i++) {
+    this->input_[i] = random_uint32();
+  }
+  this->frame_width_ = rb->width;
+  this->frame_height_ = rb->height;
+  this->input_width_ = input_width;
+  this->input_height_ = input_height;
+
+  ESP_LOGI(TAG, "%dx%d frame (%u bytes JPEG), %dx%d input, %d runs each", rb->width, rb->height, (unsigned) rb->len,
+           input_width, input_height, ITERATIONS);
+  this->kernel_ = 0;
+  this->begin_kernel_();
+  return true;
+}
+
+bool KernelBenchmark::step() {
+  if (this->kernel_ < 0) {
+    return false;
+  }
+  uint32_t start = millis();
+  do {
+    uint32_t begin = esp_cpu_get_cycle_count();
+    const bool ok = this->run_kernel_();
+    uint32_t cycles = esp_cpu_get_cycle_count() - begin;
+    if (!ok) {
+      ESP_LOGW(TAG, "%-22s failed, skipped", KERNEL_NAMES[this->kernel_]);
+      return this->next_kernel_();
+    }
+    this->min_cycles_ = std::min(this->min_cycles_, cycles);
+    this->total_cycles_ += cycles;
+    this->iterations_++;
+  } while (this->iterations_ < ITERATIONS && millis() - start < STEP_SLICE_MS);
+  if (this->iterations_ < ITERATIONS) {
+    return true;
+  }
+
+  uint32_t avg_cycles = this->total_cycles_ / ITERATIONS;
+  ESP_LOGI(TAG, "%-22s min %9u avg %9u cycles (%u us)", KERNEL_NAMES[this->kernel_], (unsigned) this->min_cycles_,
+           (unsigned) avg_cycles, (unsigned) (avg_cycles / esp_rom_get_cpu_ticks_per_us()));
+  return this->next_kernel_();
+}
+
+bool KernelBenchmark::next_kernel_() {
+  if (++this->kernel_ == KERNEL_COUNT) {
+    this->release_();
+    return false;
+  }
+  this->begin_kernel_();
+  return true;
+}
+
+void KernelBenchmark::begin_kernel_() {
+  this->iterations_ = 0;
+  this->min_cycles_ = UINT32_MAX;
+  this->total_cycles_ = 0;
+  static const int ROTATIONS[] = {0, 90, 180};
+  if (this->kernel_ >= KERNEL_ORIENTED_COPY_0 && this->kernel_ <= KERNEL_ORIENTED_COPY_180) {
+    // the offset tables are built outside the timed runs, as on a frame of a known size
+    this->orientation_ = OrientedCopy();
+    this->orientation_.set_rotation(ROTATIONS[this->kernel_ - KERNEL_ORIENTED_COPY_0]);
+    this->orientation_.configure(this->input_width_, this->input_height_, this->input_width_, this->input_height_);
+  }
+}
+
+bool KernelBenchmark::run_kernel_() {
+  static const esp_jpeg_image_scale_t SCALES[] = {JPEG_IMAGE_SCALE_1_8, JPEG_IMAGE_SCALE_1_4, JPEG_IMAGE_SCALE_1_2,
+                                                  JPEG_IMAGE_SCALE_0};
+  switch (this->kernel_) {
+    case KERNEL_DECODE_1_8:
+    case KERNEL_DECODE_1_4:
+    case KERNEL_DECODE_1_2:
+    case KERNEL_DECODE_1_1: {
+      esp_jpeg_image_cfg_t jpeg_cfg = {.indata = this->jpeg_,
+                                       .indata_size = this->jpeg_size_,
+                                       .outbuf = this->frame_,
+                                       .outbuf_size = this->frame_size_,
+                                       .out_format = JPEG_IMAGE_FORMAT_RGB888,
+                                       .out_scale = SCALES[this->kernel_ - KERNEL_DECODE_1_8],
+                                       .flags = {
+                                           .swap_color_bytes = 0,
+                                       }};
+      esp_jpeg_image_output_t outimg;
+      return esp_jpeg_decode(&jpeg_cfg, &outimg) == ESP_OK;
+    }
+    case KERNEL_CROP_RESIZE:
+      return crop_resize_rgb888(this->frame_, this->frame_width_, 0, 0, this->frame_width_, this->frame_height_,
+                                this->input_, this->input_width_, this->input_height_);
+    case KERNEL_ORIENTED_COPY_0:
+    case KERNEL_ORIENTED_COPY_90:
+    case KERNEL_ORIENTED_COPY_180:
+      this->orientation_.copy(this->input_, this->output_);
+      break;
+    case KERNEL_INPUT_COPY:
+      memcpy(this->output_, this->input_, this->input_size_);
+      break;
+    case KERNEL_FRAME_QUALITY: {
+      FrameQuality quality;
+      measure_frame_quality(this->input_, this->input_width_, this->input_height_, &quality);
+      break;
+    }
+    case KERNEL_PREVIEW_CHANGE:
+      this->preview_gate_.detect_change(this->input_, this->input_width_ / 4, this->input_height_ / 4);
+      break;
+    default:
+      break;
+  }
+  return true;
+}
+
+void KernelBenchmark::release_() {
+  ExternalRAMAllocator<uint8_t> allocator(ExternalRAMAllocator<uint8_t>::ALLOW_FAILURE);
+  if (this->jpeg_ != nullptr) {
+    allocator.deallocate(this->jpeg_, this->jpeg_size_);
+  }
+  if (this->frame_ != nullptr) {
+    allocator.deallocate(this->frame_, this->frame_size_);
+  }
+  if (this->input_ != nullptr) {
+    allocator.deallocate(this->input_, this->input_size_);
+  }
+  if (this->output_ != nullptr) {
+    allocator.deallocate(this->output_, this->input_size_);
+  }
+  this->jpeg_ = this->frame_ = this->input_ = this->output_ = nullptr;
+  this->kernel_ = -1;
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+#endif
@@ -0,0 +1,57 @@
+#pragma once
+
+#ifdef USE_ESP32
+
+#include "esp_camera.h"
+#include "image_ops.h"
+#include "preview_gate.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+// Times the per-frame kernels in CPU cycles on the device, using a real camera frame: JPEG decode at every scale,
+// crop/resize, oriented copy, input copy, frame quality and preview change detection. Counterpart of the host suite
+// in esphome/tools/litter_robot_presence_detector/kernel_bench.cpp; TFLM ops are covered by profile_ops.
+// The runs are spread over loop() calls, each step() measures for about one slice so loop() keeps its pace.
+class KernelBenchmark {
+ public:
+  // Copies the JPEG, the camera buffer can go back right away.
+  bool start(const camera_fb_t *rb, int input_width, int input_height);
+  // Runs the current kernel for one slice, false once nothing is left to measure.
+  bool step();
+
+ protected:
+  // false when the kernel failed, its timing is then dropped
+  bool run_kernel_();
+  void begin_kernel_();
+  // moves on to the next kernel, false once all ran
+  bool next_kernel_();
+  void release_();
+
+  uint8_t *jpeg_{nullptr};
+  size_t jpeg_size_{0};
+  uint8_t *frame_{nullptr};
+  size_t frame_size_{0};
+  uint8_t *input_{nullptr};
+  uint8_t *output_{nullptr};
+  size_t input_size_{0};
+  int frame_width_{0};
+  int frame_height_{0};
+  int input_width_{0};
+  int input_height_{0};
+
+  int kernel_{-1};
+  int iterations_{0};
+  uint32_t min_cycles_{0};
+  uint64_t total_cycles_{0};
+  OrientedCopy orientation_;
+  PreviewGate preview_gate_;
+};
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+
+#endif
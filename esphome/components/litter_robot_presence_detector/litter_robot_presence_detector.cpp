@@ -1,22 +1,78 @@
 #ifdef USE_ESP32
 #include "litter_robot_presence_detector.h"
+#include "dual_core.h"
+#include "kernel_benchmark.h"
+#include "memory_report.h"
+#include "logits_passthrough.h"
+#include "parallel_conv.h"
+#include "sparse_conv.h"
+#include "weight_prefetch.h"
 #include "esphome/core/log.h"
 
+#include "tensorflow/lite/micro/kernels/conv.h"
+#include "tensorflow/lite/micro/kernels/fully_connected.h"
 #include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
 #include "tensorflow/lite/micro/micro_interpreter.h"
 #include "tensorflow/lite/schema/schema_generated.h"
 #include "model_data.h"
 #include <time.h>
+#include <algorithm>
 #include <string>
 
 #include "jpeg_decoder.h"
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
 
 namespace esphome {
 namespace litter_robot_presence_detector {
 
 static const char *const TAG = "litter_robot_presence_detector";
 static const uint32_t MODEL_ARENA_SIZE = 200 * 1024;
-static const uint32_t INPUT_BUFFER_SIZE = 144 * 176 * 3 * sizeof(uint8_t);
+static const uint32_t METRICS_INTERVAL_MS = 30 * 1000;
+static const uint32_t PROFILE_INTERVAL_FRAMES = 50;
+static const uint32_t THERMAL_SAMPLE_INTERVAL_MS = 5 * 1000;
+static const int PREVIEW_MAX_SIDE = 64;
+static const uint32_t PREVIEW_BUFFER_SIZE = PREVIEW_MAX_SIDE * PREVIEW_MAX_SIDE * 3 * sizeof(uint8_t);
+// stack headroom below which the weight prefetch task warns once
+static const uint32_t PREFETCH_STACK_MARGIN = 256;
+
+// The camera may run at any power-of-two multiple of the model input, esp_jpeg scales it down while decoding.
+// Returns false when no scale hits the input exactly, `scale` is then the smallest one that still covers it.
+static bool select_decode_scale(int width, int height, int target_width, int target_height,
+                                esp_jpeg_image_scale_t *scale) {
+  static const esp_jpeg_image_scale_t SCALES[] = {JPEG_IMAGE_SCALE_0, JPEG_IMAGE_SCALE_1_2, JPEG_IMAGE_SCALE_1_4,
+                                                  JPEG_IMAGE_SCALE_1_8};
+  *scale = JPEG_IMAGE_SCALE_0;
+  for (int shift = 0; shift < 4; shift++) {
+    if ((width >> shift) == target_width && (height >> shift) == target_height) {
+      *scale = SCALES[shift];
+      return true;
+    }
+    if ((width >> shift) >= target_width && (height >> shift) >= target_height) {
+      *scale = SCALES[shift];
+    }
+  }
+  return false;
+}
+
+// Grows a PSRAM frame buffer to `size` bytes, in practice once per framesize.
+static bool reserve_frame_buffer(uint8_t **buffer, size_t *capacity, size_t size) {
+  if (size <= *capacity) {
+    return true;
+  }
+  ExternalRAMAllocator<uint8_t> allocator(ExternalRAMAllocator<uint8_t>::ALLOW_FAILURE);
+  if (*buffer != nullptr) {
+    allocator.deallocate(*buffer, *capacity);
+  }
+  *buffer = allocator.allocate(size);
+  if (*buffer == nullptr) {
+    ESP_LOGE(TAG, "Could not allocate %u bytes for the decoded frame.", (unsigned) size);
+    *capacity = 0;
+    return false;
+  }
+  *capacity = size;
+  return true;
+}
 
 float LitterRobotPresenceDetector::get_setup_priority() const { return setup_priority::AFTER_CONNECTION; }
 
@@ -26,8 +82,22 @@ void LitterRobotPresenceDetector::on_shutdown() {
   this->semaphore_ = nullptr;
 }
 
-bool LitterRobotPresenceDetector::register_preprocessor_ops(tflite::MicroMutableOpResolver<9> &micro_op_resolver) {
-  if (micro_op_resolver.AddConv2D() != kTfLiteOk) {
+bool LitterRobotPresenceDetector::register_preprocessor_ops(OpResolver &micro_op_resolver, bool prefetch_weights) {
+#if defined(USE_PARALLEL_CONV)
+  TFLMRegistration conv_registration = Register_PARALLEL_CONV_2D();
+#else
+  TFLMRegistration conv_registration = tflite::Register_CONV_2D();
+#endif
+#ifdef USE_SPARSE_CONV
+  // layers denser than the threshold keep the kernel above
+  conv_registration = Register_SPARSE_CONV_2D(conv_registration, this->sparse_max_density_);
+#endif
+#ifdef USE_WEIGHT_PREFETCH
+  if (prefetch_weights) {
+    conv_registration = Register_PREFETCHED_CONV_2D(conv_registration);
+  }
+#endif
+  if (micro_op_resolver.AddConv2D(conv_registration) != kTfLiteOk) {
     ESP_LOGE(TAG, "failed to register ops AddConv2D");
     return false;
   }
@@ -47,7 +117,13 @@ bool LitterRobotPresenceDetector::register_preprocessor_ops(tflite::MicroMutable
     return false;
   }
 
-  if (micro_op_resolver.AddFullyConnected() != kTfLiteOk) {
+  TFLMRegistration fully_connected_registration = tflite::Register_FULLY_CONNECTED();
+#ifdef USE_WEIGHT_PREFETCH
+  if (prefetch_weights) {
+    fully_connected_registration = Register_PREFETCHED_FULLY_CONNECTED(fully_connected_registration);
+  }
+#endif
+  if (micro_op_resolver.AddFullyConnected(fully_connected_registration) != kTfLiteOk) {
     ESP_LOGE(TAG, "failed to register ops AddFullyConnected");
     return false;
   }
@@ -57,7 +133,11 @@ bool LitterRobotPresenceDetector::register_preprocessor_ops(tflite::MicroMutable
     return false;
   }
 
+#ifdef USE_LOGITS_OUTPUT
+  if (micro_op_resolver.AddSoftmax(Register_SOFTMAX_PASSTHROUGH()) != kTfLiteOk) {
+#else
   if (micro_op_resolver.AddSoftmax() != kTfLiteOk) {
+#endif
     ESP_LOGE(TAG, "failed to register ops AddSoftmax");
     return false;
   }
@@ -67,16 +147,113 @@ bool LitterRobotPresenceDetector::register_preprocessor_ops(tflite::MicroMutable
     return false;
   }
 
+  // depthwise-separable (MobileNetV2 / MCUNet style) backbones
+  if (micro_op_resolver.AddDepthwiseConv2D() != kTfLiteOk) {
+    ESP_LOGE(TAG, "failed to register ops AddDepthwiseConv2D");
+    return false;
+  }
+
+  if (micro_op_resolver.AddAdd() != kTfLiteOk) {
+    ESP_LOGE(TAG, "failed to register ops AddAdd");
+    return false;
+  }
+
+  if (micro_op_resolver.AddPad() != kTfLiteOk) {
+    ESP_LOGE(TAG, "failed to register ops AddPad");
+    return false;
+  }
+
+  if (micro_op_resolver.AddRelu6() != kTfLiteOk) {
+    ESP_LOGE(TAG, "failed to register ops AddRelu6");
+    return false;
+  }
+
+  if (micro_op_resolver.AddAveragePool2D() != kTfLiteOk) {
+    ESP_LOGE(TAG, "failed to register ops AddAveragePool2D");
+    return false;
+  }
+
   return true;
 }
 
 bool LitterRobotPresenceDetector::decode_jpg(camera_fb_t *rb) {
+  TfLiteTensor *input = this->interpreter->input(0);
+  esp_jpeg_image_scale_t scale;
+  const bool exact_scale =
+      select_decode_scale(rb->width, rb->height, input->dims->data[2], input->dims->data[1], &scale);
+
+#ifdef USE_ROIS
+  if (!this->rois_.empty()) {
+    // the ROIs are cut from the full frame after the main Invoke(), so it is decoded whole on one core
+    if (!this->decode_full_frame_(rb)) {
+      return false;
+    }
+    CropBox box = {0, 0, this->frame_width_, this->frame_height_};
+#ifdef USE_MOTION_CROP
+    if (this->motion_crop_.update(this->frame_buffer_, this->frame_width_, this->frame_height_, input->dims->data[2],
+                                  input->dims->data[1], millis(), &box)) {
+      ESP_LOGD(TAG, "motion crop %dx%d at (%d,%d)", box.width, box.height, box.x, box.y);
+    }
+#endif
+    return crop_resize_rgb888(this->frame_buffer_, this->frame_width_, box.x, box.y, box.width, box.height,
+                              this->input_buffer, input->dims->data[2], input->dims->data[1]);
+  }
+#endif
+
+#ifdef USE_MOTION_CROP
+  if (this->motion_crop_.holding()) {
+    // while a crop is held every frame needs full resolution, so the motion check runs on that decode scaled down
+    // instead of on a second, scaled decode
+    if (!this->decode_full_frame_(rb)) {
+      return false;
+    }
+    if (!crop_resize_rgb888(this->frame_buffer_, this->frame_width_, 0, 0, this->frame_width_, this->frame_height_,
+                            this->input_buffer, input->dims->data[2], input->dims->data[1])) {
+      return false;
+    }
+    return this->apply_motion_crop_(rb, true);
+  }
+#endif
+
+  if (!exact_scale) {
+    // no scale lands on the input, the closest larger one is resized down to it
+    if (!this->decode_scaled_(rb, scale)) {
+      return false;
+    }
+    ESP_LOGD(TAG, "frame %dx%d decoded at %dx%d, resized to %dx%d", rb->width, rb->height, this->scaled_width_,
+             this->scaled_height_, input->dims->data[2], input->dims->data[1]);
+    if (!crop_resize_rgb888(this->scaled_buffer_, this->scaled_width_, 0, 0, this->scaled_width_,
+                            this->scaled_height_, this->input_buffer, input->dims->data[2], input->dims->data[1])) {
+      return false;
+    }
+#ifdef USE_MOTION_CROP
+    return this->apply_motion_crop_(rb, false);
+#else
+    return true;
+#endif
+  }
+
+#ifdef USE_PARALLEL_JPEG
+  esp_err_t parallel_res =
+      this->jpeg_decoder_.decode(rb->buf, rb->len, scale, this->input_buffer, this->input_buffer_size_);
+  if (parallel_res == ESP_OK) {
+#ifdef USE_MOTION_CROP
+    return this->apply_motion_crop_(rb, false);
+#else
+    return true;
+#endif
+  }
+  if (parallel_res != ESP_ERR_NOT_SUPPORTED) {
+    ESP_LOGW(TAG, "parallel decode failed (%s), retry on one core", esp_err_to_name(parallel_res));
+  }
+#endif
+
   esp_jpeg_image_cfg_t jpeg_cfg = {.indata = (uint8_t *) rb->buf,
                                    .indata_size = rb->len,
                                    .outbuf = this->input_buffer,
-                                   .outbuf_size = rb->width * rb->height * 3 * sizeof(uint16_t),
+                                   .outbuf_size = this->input_buffer_size_,
                                    .out_format = JPEG_IMAGE_FORMAT_RGB888,
-                                   .out_scale = JPEG_IMAGE_SCALE_0,
+                                   .out_scale = scale,
                                    .flags = {
                                        .swap_color_bytes = 0,
                                    }};
@@ -88,8 +265,129 @@ bool LitterRobotPresenceDetector::decode_jpg(camera_fb_t *rb) {
   }
 
   ESP_LOGD(TAG, "out img width=%d height=%d", outimg.width, outimg.height);
+#ifdef USE_MOTION_CROP
+  return this->apply_motion_crop_(rb, false);
+#else
+  return true;
+#endif
+}
+
+bool LitterRobotPresenceDetector::decode_scaled_(camera_fb_t *rb, esp_jpeg_image_scale_t scale) {
+  // the scale enum counts halvings; one spare row and column for sizes that do not divide evenly
+  const int shift = static_cast<int>(scale);
+  const size_t size = (size_t) ((rb->width >> shift) + 1) * ((rb->height >> shift) + 1) * 3;
+  if (!reserve_frame_buffer(&this->scaled_buffer_, &this->scaled_buffer_size_, size)) {
+    return false;
+  }
+
+  esp_jpeg_image_cfg_t jpeg_cfg = {.indata = (uint8_t *) rb->buf,
+                                   .indata_size = rb->len,
+                                   .outbuf = this->scaled_buffer_,
+                                   .outbuf_size = this->scaled_buffer_size_,
+                                   .out_format = JPEG_IMAGE_FORMAT_RGB888,
+                                   .out_scale = scale,
+                                   .flags = {
+                                       .swap_color_bytes = 0,
+                                   }};
+  esp_jpeg_image_output_t outimg;
+  if (esp_jpeg_decode(&jpeg_cfg, &outimg) != ESP_OK) {
+    return false;
+  }
+  this->scaled_width_ = outimg.width;
+  this->scaled_height_ = outimg.height;
+  return true;
+}
+
+#ifdef USE_MOTION_CROP
+bool LitterRobotPresenceDetector::apply_motion_crop_(camera_fb_t *rb, bool frame_decoded) {
+  // motion is found on the whole frame already scaled into the input, which also stays the input when nothing moved
+  TfLiteTensor *input = this->interpreter->input(0);
+  const int input_width = input->dims->data[2];
+  const int input_height = input->dims->data[1];
+  if (rb->width <= input_width && rb->height <= input_height) {
+    // the input already has every pixel of the frame, any crop would be grown back to the whole of it
+    return true;
+  }
+  // the crop must keep at least the input's size in frame pixels, which is this much of the input
+  const int target_width = std::max(1, input_width * input_width / rb->width);
+  const int target_height = std::max(1, input_height * input_height / rb->height);
+  CropBox box;
+  // false as well when the fitted box covers the whole frame
+  if (!this->motion_crop_.update(this->input_buffer, input_width, input_height, target_width, target_height, millis(),
+                                 &box)) {
+    return true;
+  }
+  if (!frame_decoded && !this->decode_full_frame_(rb)) {
+    return false;
+  }
+  const int x = box.x * this->frame_width_ / input_width;
+  const int y = box.y * this->frame_height_ / input_height;
+  const int width = std::min(box.width * this->frame_width_ / input_width, this->frame_width_ - x);
+  const int height = std::min(box.height * this->frame_height_ / input_height, this->frame_height_ - y);
+  ESP_LOGD(TAG, "motion crop %dx%d at (%d,%d)", width, height, x, y);
+  return crop_resize_rgb888(this->frame_buffer_, this->frame_width_, x, y, width, height, this->input_buffer,
+                            input_width, input_height);
+}
+#endif
+
+#ifdef USE_FULL_FRAME
+bool LitterRobotPresenceDetector::decode_full_frame_(camera_fb_t *rb) {
+  if (!reserve_frame_buffer(&this->frame_buffer_, &this->frame_buffer_size_, (size_t) rb->width * rb->height * 3)) {
+    return false;
+  }
+
+  esp_jpeg_image_cfg_t jpeg_cfg = {.indata = (uint8_t *) rb->buf,
+                                   .indata_size = rb->len,
+                                   .outbuf = this->frame_buffer_,
+                                   .outbuf_size = this->frame_buffer_size_,
+                                   .out_format = JPEG_IMAGE_FORMAT_RGB888,
+                                   .out_scale = JPEG_IMAGE_SCALE_0,
+                                   .flags = {
+                                       .swap_color_bytes = 0,
+                                   }};
+  esp_jpeg_image_output_t outimg;
+  if (esp_jpeg_decode(&jpeg_cfg, &outimg) != ESP_OK) {
+    return false;
+  }
+  this->frame_width_ = outimg.width;
+  this->frame_height_ = outimg.height;
   return true;
 }
+#endif
+
+#ifdef USE_ROIS
+void LitterRobotPresenceDetector::update_rois_() {
+  TfLiteTensor *input = this->interpreter->input(0);
+  const int input_width = input->dims->data[2];
+  const int input_height = input->dims->data[1];
+  // the model takes one image per Invoke(), so the regions run back to back on the frame decoded for the main output
+  for (auto &roi : this->rois_) {
+    int x = this->frame_width_ * roi.x / 100;
+    int y = this->frame_height_ * roi.y / 100;
+    int width = std::max(1, this->frame_width_ * roi.width / 100);
+    int height = std::max(1, this->frame_height_ * roi.height / 100);
+    if (!crop_resize_rgb888(this->frame_buffer_, this->frame_width_, x, y, width, height, this->input_buffer,
+                            input_width, input_height)) {
+      ESP_LOGW(TAG, "can not resize ROI '%s' to a %d pixel wide input", roi.sensor->get_name().c_str(), input_width);
+      return;
+    }
+    if (this->start_input_copy_(this->input_buffer, input) == nullptr) {
+      return;
+    }
+    this->async_copy_.wait();
+    uint32_t prior_invoke = micros();
+    if (this->interpreter->Invoke() != kTfLiteOk) {
+      ESP_LOGW(TAG, "invoke failed for ROI '%s'", roi.sensor->get_name().c_str());
+      continue;
+    }
+    int prediction_index = this->get_prediction_result();
+    int index_to_update = this->smooth_(roi.smoother, prediction_index, roi.sensor->get_name().c_str());
+    ESP_LOGD(TAG, "ROI '%s' predicted %d in %u us", roi.sensor->get_name().c_str(), prediction_index,
+             (unsigned) (micros() - prior_invoke));
+    roi.sensor->publish_state(CLASSES[index_to_update]);
+  }
+}
+#endif
 
 bool LitterRobotPresenceDetector::setup_model() {
   ExternalRAMAllocator<uint8_t> arena_allocator(ExternalRAMAllocator<uint8_t>::ALLOW_FAILURE);
@@ -99,11 +397,8 @@ bool LitterRobotPresenceDetector::setup_model() {
     return false;
   }
 
-  ExternalRAMAllocator<uint8_t> input_buffer_allocator(ExternalRAMAllocator<uint8_t>::ALLOW_FAILURE);
-  this->input_buffer = input_buffer_allocator.allocate(INPUT_BUFFER_SIZE);
-  if (this->input_buffer == nullptr) {
-    ESP_LOGE(TAG, "Could not allocate input buffer.");
-    return false;
+  if (!this->async_copy_.setup()) {
+    ESP_LOGD(TAG, "async memcpy not available, input is copied by the CPU");
   }
 
   this->model = ::tflite::GetModel(g_model_data);
@@ -115,21 +410,118 @@ bool LitterRobotPresenceDetector::setup_model() {
     return false;
   }
 
-  static tflite::MicroMutableOpResolver<9> micro_op_resolver;
+#ifdef USE_WEIGHT_PREFETCH
+  // before the ops are prepared, they register their weights with it
+  static WeightPrefetcher weight_prefetcher;
+  if (weight_prefetcher.setup(this->prefetch_buffer_size_)) {
+    global_weight_prefetcher = &weight_prefetcher;
+  }
+#endif
+
+#if defined(USE_PARALLEL_CONV) || defined(USE_PARALLEL_JPEG)
+  static DualCoreWorker dual_core_worker;
+  if (dual_core_worker.start()) {
+    global_dual_core_worker = &dual_core_worker;
+  }
+#endif
+
+  static OpResolver micro_op_resolver;
   if (!this->register_preprocessor_ops(micro_op_resolver)) {
     ESP_LOGE(TAG, "Register ops failed");
     return false;
   }
 
+#ifdef USE_OP_PROFILER
+  static tflite::MicroInterpreter static_interpreter(this->model, micro_op_resolver, this->tensor_arena_,
+                                                     MODEL_ARENA_SIZE, nullptr, &this->profiler_);
+#else
   static tflite::MicroInterpreter static_interpreter(this->model, micro_op_resolver, this->tensor_arena_,
                                                      MODEL_ARENA_SIZE);
+#endif
   this->interpreter = &static_interpreter;
 
+#ifdef USE_TFLM_COMPRESSION
+  // LUT-compressed weights are expanded per op into internal SRAM instead of the PSRAM arena
+  this->decompression_buffer_ = static_cast<uint8_t *>(
+      heap_caps_malloc(this->decompression_buffer_size_, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+  if (this->decompression_buffer_ == nullptr) {
+    ESP_LOGE(TAG, "Could not allocate %u bytes of decompression memory.",
+             (unsigned) this->decompression_buffer_size_);
+    return false;
+  }
+  static const std::initializer_list<tflite::MicroContext::AlternateMemoryRegion> decompression_regions = {
+      {this->decompression_buffer_, this->decompression_buffer_size_}};
+  if (this->interpreter->SetDecompressionMemory(decompression_regions) != kTfLiteOk) {
+    ESP_LOGE(TAG, "SetDecompressionMemory() failed");
+    return false;
+  }
+#endif
+
   TfLiteStatus allocate_status = interpreter->AllocateTensors();
   if (allocate_status != kTfLiteOk) {
     ESP_LOGE(TAG, "AllocateTensors() failed");
     return false;
   }
+#ifdef USE_LOGITS_OUTPUT
+  if (this->interpreter->output(0)->type != kTfLiteUInt8 ||
+      !find_logits_encoding(this->model, &this->logits_encoding_)) {
+    ESP_LOGE(TAG, "argmax_only needs a uint8 output 0 fed by the Softmax");
+    return false;
+  }
+  ESP_LOGD(TAG, "logits: scale=%f zero_point=%d", this->logits_encoding_.logits.scale,
+           (int) this->logits_encoding_.logits.zero_point);
+#endif
+  TfLiteTensor *input = this->interpreter->input(0);
+  // the decoder writes RGB888 at the input size, the tensor itself may take fewer channels
+  this->input_buffer_size_ = std::max<size_t>(input->bytes, (size_t) input->dims->data[1] * input->dims->data[2] * 3);
+  if (input->dims->data[2] > MAX_CROP_RESIZE_WIDTH) {
+    ESP_LOGW(TAG, "input is %d pixels wide, frames that need resizing (no exact decode scale, crops, ROIs) are dropped",
+             input->dims->data[2]);
+  }
+  // one cache line of slack: TFLM aligns tensors to 16 bytes only, GDMA copies whole cache lines when source and
+  // destination line up
+  this->input_buffer = static_cast<uint8_t *>(heap_caps_aligned_alloc(
+      ASYNC_COPY_ALIGNMENT, this->input_buffer_size_ + ASYNC_COPY_ALIGNMENT, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+  if (this->input_buffer == nullptr) {
+    ESP_LOGE(TAG, "Could not allocate %u bytes of input buffer.", (unsigned) this->input_buffer_size_);
+    return false;
+  }
+  this->input_buffer += reinterpret_cast<uintptr_t>(input->data.uint8) % ASYNC_COPY_ALIGNMENT;
+#ifdef USE_ORIENTATION
+  // OrientedCopy writes the full input size, bars included
+  this->oriented_buffer_ = static_cast<uint8_t *>(heap_caps_aligned_alloc(
+      ASYNC_COPY_ALIGNMENT, this->input_buffer_size_ + ASYNC_COPY_ALIGNMENT, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+  if (this->oriented_buffer_ == nullptr) {
+    ESP_LOGE(TAG, "Could not allocate %u bytes of oriented input buffer.", (unsigned) this->input_buffer_size_);
+    return false;
+  }
+  this->oriented_buffer_ += reinterpret_cast<uintptr_t>(input->data.uint8) % ASYNC_COPY_ALIGNMENT;
+#endif
+
+  if (!this->setup_heads_()) {
+    return false;
+  }
+#ifdef USE_ENROLLMENT
+  if (!this->setup_enrollment_()) {
+    return false;
+  }
+#endif
+#ifdef USE_SHADOW_MODEL
+  // the shadow model is optional, the detector runs on without it
+#ifdef USE_WEIGHT_PREFETCH
+  // the prefetch ring follows the production model's layer order, so the candidate gets the same ops unwrapped
+  static OpResolver shadow_op_resolver;
+  bool shadow_ops = this->register_preprocessor_ops(shadow_op_resolver, false);
+#else
+  OpResolver &shadow_op_resolver = micro_op_resolver;
+  bool shadow_ops = true;
+#endif
+  // the candidate model may only use the ops registered for the production one
+  if (!shadow_ops || !this->shadow_model_.setup(shadow_op_resolver)) {
+    ESP_LOGW(TAG, "shadow model setup failed, running without it");
+    this->shadow_model_.reset();
+  }
+#endif
 
   ESP_LOGD(TAG, "setup model successfully");
 
@@ -140,17 +532,50 @@ void LitterRobotPresenceDetector::setup() {
   ESP_LOGD(TAG, "Begin setup");
 
   // SETUP CAMERA
-  if (!esp32_camera::global_esp32_camera || esp32_camera::global_esp32_camera->is_failed()) {
+  if (!esp32_camera::global_esp32_camera) {
     ESP_LOGW(TAG, "setup litter robot presence detector failed");
     this->mark_failed();
     return;
   }
+  if (esp32_camera::global_esp32_camera->is_failed()) {
+    // the model is set up regardless, loop() keeps re-initializing the camera until frames arrive
+    ESP_LOGW(TAG, "camera failed to initialize, will retry");
+    this->camera_recovery_.record_fault(millis());
+  }
+
+  this->apply_sensor_registers_();
+  sensor_t *sensor = esp_camera_sensor_get();
+  if (sensor != nullptr) {
+    this->working_framesize_ = sensor->status.framesize;
+  }
+#ifdef USE_QUALITY_TUNER
+  this->quality_tuner_.setup();
+  this->apply_quality_step_();
+#endif
+#ifdef USE_PREVIEW
+  ExternalRAMAllocator<uint8_t> preview_allocator(ExternalRAMAllocator<uint8_t>::ALLOW_FAILURE);
+  this->preview_buffer_ = preview_allocator.allocate(PREVIEW_BUFFER_SIZE);
+  if (this->preview_buffer_ == nullptr) {
+    ESP_LOGE(TAG, "Could not allocate preview buffer.");
+    this->mark_failed();
+    return;
+  }
+  this->switch_capture_mode_(CaptureMode::PREVIEW);
+#endif
 
   if (!this->setup_model()) {
     ESP_LOGE(TAG, "setup model failed");
     this->mark_failed();
     return;
   }
+#ifdef USE_THERMAL_GOVERNOR
+  // without a temperature sensor frames are never delayed
+  this->thermal_governor_.setup();
+#endif
+#ifdef USE_REMOTE_INFERENCE
+  // without a client every frame simply runs on the device
+  this->remote_inference_.setup();
+#endif
 
   this->semaphore_ = xSemaphoreCreateBinary();
 
@@ -165,30 +590,398 @@ void LitterRobotPresenceDetector::setup() {
   ESP_LOGD(TAG, "setup litter robot presence detector successfully");
 }
 
+void LitterRobotPresenceDetector::apply_sensor_registers_() {
+  if (this->sensor_registers_.empty()) {
+    return;
+  }
+
+  sensor_t *sensor = esp_camera_sensor_get();
+  if (sensor == nullptr) {
+    ESP_LOGW(TAG, "camera sensor not available, skip register writes");
+    return;
+  }
+
+  for (auto &reg : this->sensor_registers_) {
+    if (sensor->set_reg(sensor, reg.address, reg.mask, reg.value) != 0) {
+      ESP_LOGW(TAG, "failed to write sensor register 0x%04X", reg.address);
+    }
+  }
+}
+
+void LitterRobotPresenceDetector::recover_camera_() {
+  esp32_camera::ESP32Camera *camera = esp32_camera::global_esp32_camera;
+  ESP_LOGW(TAG, "re-initializing camera, attempt %u", (unsigned) this->camera_recovery_.attempts());
+  sensor_t *sensor;
+  if (camera->is_failed()) {
+    // esp_camera_init failed before the camera component started its frame task, so running its setup again is safe.
+    // call() runs setup() right away and moves the camera out of the construction state, so the application loop
+    // does not set it up a second time.
+    esp_camera_deinit();
+    camera->reset_to_construction_state();
+    camera->call();
+    sensor = esp_camera_sensor_get();
+    if (camera->is_failed() || sensor == nullptr) {
+      ESP_LOGW(TAG, "camera re-initialization failed");
+      return;
+    }
+  } else {
+    sensor = esp_camera_sensor_get();
+    if (sensor == nullptr || sensor->reset(sensor) != 0) {
+      ESP_LOGW(TAG, "camera sensor reset failed");
+      return;
+    }
+    // the reset restores power-on defaults
+    camera->update_camera_parameters();
+  }
+  // put back everything that was written since
+  this->apply_sensor_registers_();
+  if (this->working_framesize_ < 0) {
+    this->working_framesize_ = sensor->status.framesize;
+  }
+  this->pending_framesize_ = -1;
+#ifdef USE_QUALITY_TUNER
+  this->apply_quality_step_();
+#endif
+#ifdef USE_PREVIEW
+  this->switch_capture_mode_(this->preview_gate_.mode());
+#else
+  this->set_capture_framesize_(this->working_framesize_);
+#endif
+}
+
+void LitterRobotPresenceDetector::set_capture_framesize_(int framesize) {
+  sensor_t *sensor = esp_camera_sensor_get();
+  if (sensor == nullptr || framesize < 0 || sensor->status.framesize == framesize) {
+    return;
+  }
+
+  if (sensor->set_framesize(sensor, (framesize_t) framesize) != 0) {
+    ESP_LOGW(TAG, "failed to set framesize %d", framesize);
+    return;
+  }
+  this->pending_framesize_ = framesize;
+  this->reconfig_started_ = millis();
+}
+
+bool LitterRobotPresenceDetector::check_frame_size_(camera_fb_t *rb) {
+  if (this->pending_framesize_ < 0) {
+    return true;
+  }
+
+  const resolution_info_t &expected = resolution[this->pending_framesize_];
+  if (rb->width != expected.width || rb->height != expected.height) {
+    ESP_LOGV(TAG, "drop %dx%d frame captured before framesize switch", rb->width, rb->height);
+    return false;
+  }
+
+  this->reconfig_ms_ = millis() - this->reconfig_started_;
+  this->pending_framesize_ = -1;
+  ESP_LOGD(TAG, "framesize switch to %dx%d took %u ms", rb->width, rb->height, (unsigned) this->reconfig_ms_);
+  return true;
+}
+
+#ifdef USE_QUALITY_TUNER
+void LitterRobotPresenceDetector::apply_quality_step_() {
+  if (this->quality_tuner_.empty()) {
+    return;
+  }
+
+  sensor_t *sensor = esp_camera_sensor_get();
+  if (sensor == nullptr) {
+    return;
+  }
+
+  const QualityStep &step = this->quality_tuner_.current();
+  if (sensor->set_quality(sensor, step.jpeg_quality) != 0) {
+    ESP_LOGW(TAG, "failed to apply jpeg quality %d", step.jpeg_quality);
+    return;
+  }
+  this->working_framesize_ = step.framesize;
+#ifdef USE_PREVIEW
+  if (this->preview_gate_.mode() == CaptureMode::PREVIEW) {
+    // applied when the preview gate switches back to working resolution
+    return;
+  }
+#endif
+  this->set_capture_framesize_(step.framesize);
+  ESP_LOGI(TAG, "camera step %u/%u: framesize %d jpeg quality %d", (unsigned) this->quality_tuner_.current_index(),
+           (unsigned) this->quality_tuner_.size(), step.framesize, step.jpeg_quality);
+}
+#endif
+
+#ifdef USE_PREVIEW
+void LitterRobotPresenceDetector::switch_capture_mode_(CaptureMode mode) {
+  this->preview_gate_.set_mode(mode);
+  this->set_capture_framesize_(mode == CaptureMode::PREVIEW ? this->preview_framesize_ : this->working_framesize_);
+  ESP_LOGI(TAG, "capture mode: %s", mode == CaptureMode::PREVIEW ? "preview" : "working");
+}
+
+bool LitterRobotPresenceDetector::handle_preview_(camera_fb_t *rb) {
+  if (this->preview_gate_.mode() == CaptureMode::WORKING) {
+    return true;
+  }
+
+  int shift = 0;
+  while (shift < 3 && ((rb->width >> shift) > PREVIEW_MAX_SIDE || (rb->height >> shift) > PREVIEW_MAX_SIDE)) {
+    shift++;
+  }
+  if ((rb->width >> shift) > PREVIEW_MAX_SIDE || (rb->height >> shift) > PREVIEW_MAX_SIDE) {
+    ESP_LOGW(TAG, "preview frame %dx%d too large", rb->width, rb->height);
+    return false;
+  }
+
+  esp_jpeg_image_cfg_t jpeg_cfg = {.indata = (uint8_t *) rb->buf,
+                                   .indata_size = rb->len,
+                                   .outbuf = this->preview_buffer_,
+                                   .outbuf_size = PREVIEW_BUFFER_SIZE,
+                                   .out_format = JPEG_IMAGE_FORMAT_RGB888,
+                                   .out_scale = (esp_jpeg_image_scale_t) shift,
+                                   .flags = {
+                                       .swap_color_bytes = 0,
+                                   }};
+  esp_jpeg_image_output_t outimg;
+  if (esp_jpeg_decode(&jpeg_cfg, &outimg) != ESP_OK) {
+    ESP_LOGW(TAG, "cant decode preview frame");
+    return false;
+  }
+
+  if (this->preview_gate_.detect_change(this->preview_buffer_, outimg.width, outimg.height)) {
+    // the smoothing window still holds "empty", so the switch latency is absorbed before the state can change
+    this->switch_capture_mode_(CaptureMode::WORKING);
+  }
+  return false;
+}
+#endif
+
 void LitterRobotPresenceDetector::loop() {
   if (!this->is_ready()) {
     ESP_LOGW(TAG, "not ready yet, skip!");
     return;
   }
 
+  if (millis() - this->last_metrics_publish_ >= METRICS_INTERVAL_MS) {
+    this->publish_metrics_();
+  }
+#ifdef USE_KERNEL_BENCHMARK
+  // frames wait while the benchmark measures, one slice per loop()
+  if (this->kernel_benchmark_.step()) {
+    return;
+  }
+#endif
+#ifdef USE_THERMAL_GOVERNOR
+  if (millis() - this->last_thermal_sample_ >= THERMAL_SAMPLE_INTERVAL_MS) {
+    this->last_thermal_sample_ = millis();
+    if (this->thermal_governor_.update()) {
+      this->apply_thermal_level_();
+    }
+  }
+  if (millis() - this->last_frame_start_ < this->thermal_governor_.frame_delay()) {
+    return;
+  }
+  this->last_frame_start_ = millis();
+#endif
+
+  if (esp32_camera::global_esp32_camera->is_failed() && this->camera_recovery_.record_fault(millis())) {
+    ESP_LOGW(TAG, "camera failed, recovering");
+  }
+  if (this->camera_recovery_.attempt_due(millis())) {
+    this->recover_camera_();
+    return;
+  }
+  if (esp32_camera::global_esp32_camera->is_failed()) {
+    return;
+  }
+
   esp32_camera::global_esp32_camera->request_image(esphome::esp32_camera::API_REQUESTER);
   auto image = this->wait_for_image_();
 
   if (!image) {
-    ESP_LOGW(TAG, "SNAPSHOT: failed to acquire frame");
+    ESP_LOGV(TAG, "SNAPSHOT: failed to acquire frame");
+    if (this->camera_recovery_.record_failure(millis())) {
+      ESP_LOGW(TAG, "frames stopped arriving, recovering camera");
+    }
     return;
   }
   this->image_ = nullptr;
+  if (this->camera_recovery_.record_frame(millis())) {
+    ESP_LOGI(TAG, "camera recovered after %u ms", (unsigned) this->camera_recovery_.last_recovery_ms());
+    if (this->recovery_time_sensor_ != nullptr) {
+      this->recovery_time_sensor_->publish_state(this->camera_recovery_.last_recovery_ms());
+    }
+  }
+
+  if (!this->check_frame_size_(image->get_raw_buffer())) {
+    return;
+  }
+#ifdef USE_PREVIEW
+  if (!this->handle_preview_(image->get_raw_buffer())) {
+    return;
+  }
+#endif
+#ifdef USE_KERNEL_BENCHMARK
+  if (!this->kernels_benchmarked_) {
+    // once, on the first frame at working resolution; the runs follow in the next loop() calls
+    this->kernels_benchmarked_ = true;
+    TfLiteTensor *input = this->interpreter->input(0);
+    this->kernel_benchmark_.start(image->get_raw_buffer(), input->dims->data[2], input->dims->data[1]);
+  }
+#endif
 
-  if (!this->start_infer(image)) {
+  bool remote = false;
+#ifdef USE_REMOTE_INFERENCE
+  // esp32-camera stamps frames with esp_timer_get_time() when their capture ends
+  const struct timeval &captured = image->get_raw_buffer()->timestamp;
+  const int64_t captured_us = (int64_t) captured.tv_sec * 1000000 + captured.tv_usec;
+  remote = this->offload_frame_(image->get_raw_buffer());
+#endif
+  InferResult result = remote ? InferResult::DONE : this->start_infer(std::move(image));
+  if (result == InferResult::FAILED) {
     ESP_LOGE(TAG, "infer failed");
-  } else {
+  } else if (result == InferResult::DONE) {
     int prediction_index = this->get_prediction_result();
+#ifdef USE_QUALITY_TUNER
+    if (!remote && this->quality_tuner_.update(this->last_margin_, this->timings_.decode_us)) {
+      this->apply_quality_step_();
+    }
+#endif
+#ifdef USE_ENROLLMENT
+    if (!remote) {
+      prediction_index = this->classify_enrolled_(prediction_index);
+    }
+#endif
     int index_to_update = this->decide_state(prediction_index);
-    std::string state_to_update = CLASSES[index_to_update];
-    ESP_LOGI(TAG, "predicted class %s. Final state to update: %s", CLASSES[prediction_index].c_str(),
+    std::string state_to_update = this->state_name_(index_to_update);
+    ESP_LOGI(TAG, "predicted class %s. Final state to update: %s", this->state_name_(prediction_index).c_str(),
              state_to_update.c_str());
     this->publish_state(state_to_update);
+#ifdef USE_REMOTE_INFERENCE
+    // how late the state is, queueing behind a slow frame included, decides the share that goes to the server
+    this->remote_inference_.record_result_age(esp_timer_get_time() - captured_us);
+#endif
+    // the remote server only returns the main output, auxiliary heads keep their last state
+    if (!remote) {
+      this->update_heads_();
+    }
+#ifdef USE_SHADOW_MODEL
+    if (!remote && this->shadow_pending_) {
+      this->shadow_model_.run(this->interpreter->output(0));
+    }
+#endif
+#ifdef USE_ROIS
+    // clobbers the outputs, so it runs after everything else that reads them
+    if (!remote) {
+      this->update_rois_();
+    }
+#endif
+#ifdef USE_PREVIEW
+    if (this->preview_gate_.update_decision(index_to_update == 0)) {
+      this->switch_capture_mode_(CaptureMode::PREVIEW);
+    }
+#endif
+  }
+}
+
+#ifdef USE_THERMAL_GOVERNOR
+void LitterRobotPresenceDetector::apply_thermal_level_() {
+#ifdef USE_QUALITY_TUNER
+  // HOT pins the ladder to its cheapest step, the tuner climbs back on its own once it is released
+  bool hot = this->thermal_governor_.level() == ThermalLevel::HOT;
+  if (this->quality_tuner_.set_ceiling(hot ? 0 : SIZE_MAX)) {
+    this->apply_quality_step_();
+  }
+#endif
+  ESP_LOGD(TAG, "frame delay now %u ms", (unsigned) this->thermal_governor_.frame_delay());
+}
+#endif
+
+#ifdef USE_REMOTE_INFERENCE
+bool LitterRobotPresenceDetector::offload_frame_(camera_fb_t *rb) {
+  if (!this->remote_inference_.should_offload()) {
+    return false;
+  }
+  // the remote scores take the place of output 0, which stays valid until the next Invoke()
+  TfLiteTensor *output = this->interpreter->output(0);
+  const int num_classes = output->dims->data[output->dims->size - 1];
+  if (!this->remote_inference_.infer(rb->buf, rb->len, output->data.uint8, num_classes)) {
+    ESP_LOGD(TAG, "remote inference missed its deadline, run on device");
+    return false;
+  }
+  return true;
+}
+#endif
+
+void LitterRobotPresenceDetector::publish_metrics_() {
+  this->last_metrics_publish_ = millis();
+  this->publish_memory_();
+  if (this->skipped_frames_sensor_ != nullptr) {
+    this->skipped_frames_sensor_->publish_state(this->skipped_frames_);
+  }
+  if (this->recoveries_sensor_ != nullptr) {
+    this->recoveries_sensor_->publish_state(this->camera_recovery_.recoveries());
+  }
+#ifdef USE_THERMAL_GOVERNOR
+  if (this->chip_temperature_sensor_ != nullptr) {
+    this->chip_temperature_sensor_->publish_state(this->thermal_governor_.temperature());
+  }
+  if (this->throttled_time_sensor_ != nullptr) {
+    this->throttled_time_sensor_->publish_state(this->thermal_governor_.throttled_ms(millis()) / 1000);
+  }
+#endif
+#ifdef USE_REMOTE_INFERENCE
+  if (this->offloaded_frames_sensor_ != nullptr) {
+    this->offloaded_frames_sensor_->publish_state(this->remote_inference_.offloaded_frames());
+  }
+#endif
+#ifdef USE_SHADOW_MODEL
+  if (this->shadow_model_.frames() > 0) {
+    if (this->shadow_agreement_sensor_ != nullptr) {
+      this->shadow_agreement_sensor_->publish_state(this->shadow_model_.agreement_percent());
+    }
+    if (this->shadow_latency_sensor_ != nullptr) {
+      this->shadow_latency_sensor_->publish_state(this->shadow_model_.mean_latency_ms());
+    }
+    if (this->shadow_score_delta_sensor_ != nullptr) {
+      this->shadow_score_delta_sensor_->publish_state(this->shadow_model_.mean_score_delta());
+    }
+  }
+#endif
+}
+
+// covers the helper tasks that are running
+static void sample_task_memory(MemoryReport *report) {
+  sample_memory(global_dual_core_worker != nullptr ? global_dual_core_worker->task() : nullptr,
+                global_weight_prefetcher != nullptr ? global_weight_prefetcher->task() : nullptr, report);
+  if (global_weight_prefetcher != nullptr && global_weight_prefetcher->task() != nullptr) {
+    report->prefetch_core = global_weight_prefetcher->core();
+  }
+}
+
+void LitterRobotPresenceDetector::publish_memory_() {
+  MemoryReport report;
+  sample_task_memory(&report);
+  if (this->arena_used_sensor_ != nullptr) {
+    this->arena_used_sensor_->publish_state(this->interpreter->arena_used_bytes());
+  }
+  if (this->internal_free_sensor_ != nullptr) {
+    this->internal_free_sensor_->publish_state(report.internal_free);
+  }
+  if (this->internal_largest_block_sensor_ != nullptr) {
+    this->internal_largest_block_sensor_->publish_state(report.internal_largest_block);
+  }
+  if (this->psram_free_sensor_ != nullptr) {
+    this->psram_free_sensor_->publish_state(report.psram_free);
+  }
+  if (this->psram_largest_block_sensor_ != nullptr) {
+    this->psram_largest_block_sensor_->publish_state(report.psram_largest_block);
+  }
+  if (this->stack_free_sensor_ != nullptr) {
+    this->stack_free_sensor_->publish_state(report.loop_stack_free);
+  }
+  if (global_weight_prefetcher != nullptr && report.prefetch_stack_free < PREFETCH_STACK_MARGIN &&
+      !this->prefetch_stack_warned_) {
+    ESP_LOGW(TAG, "Weight prefetch task has %u of %u stack bytes left", (unsigned) report.prefetch_stack_free,
+             (unsigned) global_weight_prefetcher->stack_size());
+    this->prefetch_stack_warned_ = true;
   }
 }
 
@@ -211,6 +1004,133 @@ void LitterRobotPresenceDetector::dump_config() {
   ESP_LOGCONFIG(TAG, "  - dims (%d,%d)", output->dims->data[0], output->dims->data[1]);
   ESP_LOGCONFIG(TAG, "  - zero_point=%d scale=%f", output->params.zero_point, output->params.scale);
   ESP_LOGCONFIG(TAG, "  - output_type: %d", output->type);
+  MemoryReport memory;
+  sample_task_memory(&memory);
+  ESP_LOGCONFIG(TAG, "Memory");
+  ESP_LOGCONFIG(TAG, "  - arena used %u of %u bytes", (unsigned) this->interpreter->arena_used_bytes(),
+                (unsigned) MODEL_ARENA_SIZE);
+  ESP_LOGCONFIG(TAG, "  - internal free %u, largest block %u, minimum free %u", (unsigned) memory.internal_free,
+                (unsigned) memory.internal_largest_block, (unsigned) memory.internal_min_free);
+  ESP_LOGCONFIG(TAG, "  - psram free %u, largest block %u", (unsigned) memory.psram_free,
+                (unsigned) memory.psram_largest_block);
+  ESP_LOGCONFIG(TAG, "  - stack free: loop %u, worker %u, prefetch %u", (unsigned) memory.loop_stack_free,
+                (unsigned) memory.worker_stack_free, (unsigned) memory.prefetch_stack_free);
+  if (memory.prefetch_core >= 0) {
+    ESP_LOGCONFIG(TAG, "  - prefetch task on core %d at priority %u, worker priority %u", memory.prefetch_core,
+                  (unsigned) memory.prefetch_priority, (unsigned) memory.worker_priority);
+  }
+  LOG_SENSOR("  ", "Arena used", this->arena_used_sensor_);
+  LOG_SENSOR("  ", "Internal free", this->internal_free_sensor_);
+  LOG_SENSOR("  ", "Internal largest block", this->internal_largest_block_sensor_);
+  LOG_SENSOR("  ", "PSRAM free", this->psram_free_sensor_);
+  LOG_SENSOR("  ", "PSRAM largest block", this->psram_largest_block_sensor_);
+  LOG_SENSOR("  ", "Stack free", this->stack_free_sensor_);
+  for (auto &head : this->heads_) {
+    LOG_TEXT_SENSOR("", "Output head", head.sensor);
+    ESP_LOGCONFIG(TAG, "    Output: %u, classes: %u", (unsigned) head.output_index, (unsigned) head.classes.size());
+  }
+#ifdef USE_ENROLLMENT
+  ESP_LOGCONFIG(TAG, "Enrollment: output %u, %u cats", (unsigned) this->embedding_output_,
+                (unsigned) this->enrollment_.size());
+  for (size_t i = 0; i < this->enrollment_.size(); i++) {
+    ESP_LOGCONFIG(TAG, "  - %s", this->enrollment_.name(i));
+  }
+#endif
+#ifdef USE_LOGITS_OUTPUT
+  ESP_LOGCONFIG(TAG, "Softmax: skipped, scores rebuilt from logits (scale=%f zero_point=%d)",
+                this->logits_encoding_.logits.scale, (int) this->logits_encoding_.logits.zero_point);
+#endif
+  ESP_LOGCONFIG(TAG, "Input copies: %u by DMA, %u by CPU", (unsigned) this->async_copy_.dma_copies(),
+                (unsigned) this->async_copy_.cpu_copies());
+#ifdef USE_WEIGHT_PREFETCH
+  if (global_weight_prefetcher != nullptr) {
+    ESP_LOGCONFIG(TAG, "Weight prefetch: %u of %u layers staged in 2x%u bytes, %u hits, %u misses",
+                  (unsigned) global_weight_prefetcher->num_staged(), (unsigned) global_weight_prefetcher->num_layers(),
+                  (unsigned) global_weight_prefetcher->buffer_size(),
+                  (unsigned) global_weight_prefetcher->prefetch_hits(),
+                  (unsigned) global_weight_prefetcher->prefetch_misses());
+  } else {
+    ESP_LOGCONFIG(TAG, "Weight prefetch: not started");
+  }
+#endif
+#ifdef USE_KERNEL_BENCHMARK
+  ESP_LOGCONFIG(TAG, "Kernel benchmark: on the first frame");
+#endif
+#ifdef USE_OP_PROFILER
+  ESP_LOGCONFIG(TAG, "Op profiler: every %u frames", (unsigned) PROFILE_INTERVAL_FRAMES);
+#endif
+#ifdef USE_SPARSE_CONV
+  ESP_LOGCONFIG(TAG, "Sparse Conv2D: enabled");
+#endif
+#ifdef USE_PARALLEL_CONV
+  ESP_LOGCONFIG(TAG, "Parallel Conv2D: %s",
+                global_dual_core_worker != nullptr ? "both cores" : "single core (worker not started)");
+#endif
+#ifdef USE_QUALITY_TUNER
+  ESP_LOGCONFIG(TAG, "Quality tuner: %u steps", (unsigned) this->quality_tuner_.size());
+#endif
+#ifdef USE_TFLM_COMPRESSION
+  ESP_LOGCONFIG(TAG, "Compressed weights: %u bytes decompression memory", (unsigned) this->decompression_buffer_size_);
+#endif
+#ifdef USE_QUALITY_GATE
+  ESP_LOGCONFIG(TAG, "Frame quality gate: enabled");
+#endif
+  LOG_SENSOR("", "Skipped frames", this->skipped_frames_sensor_);
+#ifdef USE_PREVIEW
+  ESP_LOGCONFIG(TAG, "Preview framesize: %d, working framesize: %d", this->preview_framesize_,
+                this->working_framesize_);
+#endif
+#ifdef USE_PARALLEL_JPEG
+  ESP_LOGCONFIG(TAG, "Parallel JPEG decode: %s",
+                global_dual_core_worker != nullptr ? "split at restart markers" : "single core (worker not started)");
+#endif
+#ifdef USE_ORIENTATION
+  ESP_LOGCONFIG(TAG, "Orientation: rotate %d, mirror %s", this->orientation_.rotation(),
+                YESNO(this->orientation_.mirror()));
+#endif
+#ifdef USE_ROIS
+  for (auto &roi : this->rois_) {
+    LOG_TEXT_SENSOR("", "ROI", roi.sensor);
+    ESP_LOGCONFIG(TAG, "    x=%u%% y=%u%% width=%u%% height=%u%%", roi.x, roi.y, roi.width, roi.height);
+  }
+#endif
+#ifdef USE_MOTION_CROP
+  ESP_LOGCONFIG(TAG, "Motion crop: %u of %u frames cropped", (unsigned) this->motion_crop_.cropped_frames(),
+                (unsigned) this->motion_crop_.frames());
+#endif
+#ifdef USE_THERMAL_GOVERNOR
+  ESP_LOGCONFIG(TAG, "Thermal governor: %.1f°C, frame delay %u ms", this->thermal_governor_.temperature(),
+                (unsigned) this->thermal_governor_.frame_delay());
+  LOG_SENSOR("  ", "Chip temperature", this->chip_temperature_sensor_);
+  LOG_SENSOR("  ", "Throttled time", this->throttled_time_sensor_);
+#endif
+#ifdef USE_REMOTE_INFERENCE
+  ESP_LOGCONFIG(TAG, "Remote inference: %s", this->remote_inference_.url().c_str());
+  ESP_LOGCONFIG(TAG, "  Offload share: %u%%, offloaded: %u, fallbacks: %u",
+                (unsigned) this->remote_inference_.offload_percent(),
+                (unsigned) this->remote_inference_.offloaded_frames(), (unsigned) this->remote_inference_.fallbacks());
+  LOG_SENSOR("  ", "Offloaded frames", this->offloaded_frames_sensor_);
+#endif
+#ifdef USE_SHADOW_MODEL
+  if (this->shadow_model_.enabled()) {
+    ESP_LOGCONFIG(TAG, "Shadow model: %u frames compared", (unsigned) this->shadow_model_.frames());
+  } else {
+    ESP_LOGCONFIG(TAG, "Shadow model: disabled, setup failed");
+  }
+  LOG_SENSOR("  ", "Agreement", this->shadow_agreement_sensor_);
+  LOG_SENSOR("  ", "Latency", this->shadow_latency_sensor_);
+  LOG_SENSOR("  ", "Score delta", this->shadow_score_delta_sensor_);
+#endif
+  static const char *const CAMERA_HEALTH[] = {"healthy", "failing", "recovering"};
+  ESP_LOGCONFIG(TAG, "Camera recovery");
+  ESP_LOGCONFIG(TAG, "  - %s, %u recoveries, last took %u ms",
+                CAMERA_HEALTH[static_cast<int>(this->camera_recovery_.health())],
+                (unsigned) this->camera_recovery_.recoveries(), (unsigned) this->camera_recovery_.last_recovery_ms());
+  LOG_SENSOR("  ", "Time to recovery", this->recovery_time_sensor_);
+  LOG_SENSOR("  ", "Recoveries", this->recoveries_sensor_);
+  for (auto &reg : this->sensor_registers_) {
+    ESP_LOGCONFIG(TAG, "Sensor register 0x%04X = 0x%02X (mask 0x%02X)", reg.address, reg.value, reg.mask);
+  }
 }
 
 std::shared_ptr<esphome::esp32_camera::CameraImage> LitterRobotPresenceDetector::wait_for_image_() {
@@ -225,87 +1145,289 @@ std::shared_ptr<esphome::esp32_camera::CameraImage> LitterRobotPresenceDetector:
 
   return image;
 }
-bool LitterRobotPresenceDetector::start_infer(std::shared_ptr<esphome::esp32_camera::CameraImage> image) {
+const uint8_t *LitterRobotPresenceDetector::start_input_copy_(const uint8_t *frame, TfLiteTensor *input) {
+  // the copy length comes from the tensor, the source buffers from setup_model()
+  if (input->bytes > this->input_buffer_size_) {
+    ESP_LOGE(TAG, "input tensor of %u bytes does not fit the %u byte input buffer", (unsigned) input->bytes,
+             (unsigned) this->input_buffer_size_);
+    return nullptr;
+  }
+#ifdef USE_ORIENTATION
+  // the decoded frame has the input size before rotation; oriented next to it so the DMA copy still applies
+  this->orientation_.configure(input->dims->data[2], input->dims->data[1], input->dims->data[2],
+                               input->dims->data[1]);
+  this->orientation_.copy(frame, this->oriented_buffer_);
+  frame = this->oriented_buffer_;
+#endif
+  this->async_copy_.start(input->data.uint8, frame, input->bytes);
+  return frame;
+}
+
+InferResult LitterRobotPresenceDetector::start_infer(std::shared_ptr<esphome::esp32_camera::CameraImage> image) {
   camera_fb_t *rb = image->get_raw_buffer();
   ESP_LOGD(TAG, " Received image size width=%d height=%d", rb->width, rb->height);
 
   TfLiteTensor *input = this->interpreter->input(0);
-  size_t bytes_to_copy = input->bytes;
-  uint32_t prior_invoke = millis();
+  uint32_t prior_decode = micros();
   if (!this->decode_jpg(rb)) {
     ESP_LOGE(TAG, "cant decode to rgb");
-    return false;
+    return InferResult::FAILED;
   }
 
-  memcpy(input->data.uint8, this->input_buffer, bytes_to_copy);
+  // the DMA engine fills the input tensor while the camera buffer is handed back and the quality stats run
+  const uint8_t *frame = this->start_input_copy_(this->input_buffer, input);
+  if (frame == nullptr) {
+    return InferResult::FAILED;
+  }
+  image.reset();
+  bool request_next = true;
+#ifdef USE_THERMAL_GOVERNOR
+  // a throttled loop would only pick the frame up, stale, once the delay ran out
+  request_next = this->thermal_governor_.frame_delay() == 0;
+#endif
+  if (request_next) {
+    // captured while the model runs, loop() finds it waiting
+    esp32_camera::global_esp32_camera->request_image(esphome::esp32_camera::API_REQUESTER);
+  }
+#ifdef USE_QUALITY_GATE
+  FrameQuality quality;
+  measure_frame_quality(frame, input->dims->data[2], input->dims->data[1], &quality);
+  const char *reject_reason = this->quality_gate_.check(quality);
+  if (reject_reason != nullptr) {
+    this->async_copy_.wait();
+    this->skipped_frames_++;
+    ESP_LOGD(TAG, "skip frame: %s (luma=%u dark=%u%% saturated=%u%% gradient=%u)", reject_reason, quality.mean_luma,
+             quality.dark_percent, quality.saturated_percent, quality.gradient);
+    return InferResult::SKIPPED;
+  }
+#endif
+
+  uint32_t prior_invoke = micros();
+  this->async_copy_.wait();
+#ifdef USE_SHADOW_MODEL
+  // Invoke() may reuse the input tensor's memory for activations, so the candidate copies it first
+  this->shadow_pending_ = this->shadow_model_.should_run() && this->shadow_model_.capture(input);
+  prior_invoke = micros();
+#endif
   TfLiteStatus invokeStatus = this->interpreter->Invoke();
-  ESP_LOGD(TAG, " Inference Latency=%u ms", (millis() - prior_invoke));
-  return invokeStatus == kTfLiteOk;
+  uint32_t done = micros();
+#ifdef USE_LOGITS_OUTPUT
+  if (invokeStatus == kTfLiteOk) {
+    TfLiteTensor *output = this->interpreter->output(0);
+    logits_to_scores(output->data.uint8, output->bytes, this->logits_encoding_, output->data.uint8);
+  }
+#endif
+#ifdef USE_OP_PROFILER
+  // per-op ticks of one frame, to compare backbones on the same input
+  if (++this->profiled_frames_ >= PROFILE_INTERVAL_FRAMES) {
+    this->profiled_frames_ = 0;
+    this->profiler_.LogTicksPerTagCsv();
+  }
+  this->profiler_.ClearEvents();
+#endif
+
+  this->timings_.decode_us = prior_invoke - prior_decode;
+  this->timings_.invoke_us = done - prior_invoke;
+  ESP_LOGD(TAG, " Inference Latency=%u ms (decode=%u us, invoke=%u us)", (unsigned) ((done - prior_decode) / 1000),
+           (unsigned) this->timings_.decode_us, (unsigned) this->timings_.invoke_us);
+  return invokeStatus == kTfLiteOk ? InferResult::DONE : InferResult::FAILED;
 }
 
-int LitterRobotPresenceDetector::get_prediction_result() {
-  TfLiteTensor *output = this->interpreter->output(0);
+int LitterRobotPresenceDetector::get_prediction_result(size_t output_index) {
+  TfLiteTensor *output = this->interpreter->output(output_index);
+  const int num_classes = output->dims->data[output->dims->size - 1];
+  const uint8_t *scores = output->data.uint8;
 
-  auto empty_score = output->data.uint8[0];
-  auto nachi_score = output->data.uint8[1];
-  auto ngao_score = output->data.uint8[2];
-  ESP_LOGD(TAG, "empty_score=%d nachi_score=%d ngao_score=%d", empty_score, nachi_score, ngao_score);
+  char scores_str[64];
+  size_t pos = 0;
+  for (int i = 0; i < num_classes && pos < sizeof(scores_str); ++i) {
+    pos += snprintf(scores_str + pos, sizeof(scores_str) - pos, " %d", scores[i]);
+  }
+  ESP_LOGD(TAG, "output %u scores:%s", (unsigned) output_index, scores_str);
 
-  uint8_t scores[] = {empty_score, nachi_score, ngao_score};
   int max_index = 0;
-  for (int i = 1; i < 3; ++i) {
+  for (int i = 1; i < num_classes; ++i) {
     if (scores[i] > scores[max_index]) {
       max_index = i;
     }
   }
 
+  if (output_index == 0) {
+    uint8_t runner_up = 0;
+    for (int i = 0; i < num_classes; ++i) {
+      if (i != max_index && scores[i] > runner_up) {
+        runner_up = scores[i];
+      }
+    }
+    this->last_margin_ = scores[max_index] - runner_up;
+  }
+
   return max_index;
 }
 
-int LitterRobotPresenceDetector::decide_state(int max_index) {
-#ifndef USE_EMA
-  // Update prediction history for each class
-  this->prediction_history[this->last_index] = max_index;
-  this->last_index += 1;
-  if (this->last_index == PREDICTION_HISTORY_SIZE) {
-    this->last_index = 0;
+#ifdef USE_ENROLLMENT
+bool LitterRobotPresenceDetector::setup_enrollment_() {
+  if (this->embedding_output_ >= this->interpreter->outputs_size()) {
+    ESP_LOGE(TAG, "model has no embedding output %u", (unsigned) this->embedding_output_);
+    return false;
+  }
+  TfLiteTensor *embedding = this->interpreter->output(this->embedding_output_);
+  size_t dim = embedding->dims->data[embedding->dims->size - 1];
+  if ((embedding->type != kTfLiteInt8 && embedding->type != kTfLiteUInt8) || dim > MAX_EMBEDDING_DIM) {
+    ESP_LOGE(TAG, "embedding output must be 8-bit with at most %u values", (unsigned) MAX_EMBEDDING_DIM);
+    return false;
   }
 
-  // Calculate the average score for each class
-  uint8_t class_counts[3] = {0};
-  for (int i = 0; i < PREDICTION_HISTORY_SIZE; i++) {
-    class_counts[this->prediction_history[i]] += 1;
+  this->enrollment_.set_dim(dim);
+  // v2: prototypes widened to int16
+  uint32_t hash = fnv1_hash("litter_robot_enrollment_v2") ^ this->get_object_id_hash();
+  this->enrollment_pref_ = global_preferences->make_preference<PrototypeStore>(hash);
+  PrototypeStore &store = this->enrollment_.store();
+  if (!this->enrollment_pref_.load(&store) || store.dim != dim || store.count > MAX_ENROLLED_CATS) {
+    // nothing saved yet or saved for another model
+    this->enrollment_.clear();
   }
+  this->enrollment_.update_norms();
+  ESP_LOGD(TAG, "%u enrolled cats, embedding dim %u", (unsigned) this->enrollment_.size(), (unsigned) dim);
+  return true;
+}
 
-  // Determine the class with the highest average score
-  int max_class_index = 0;
-  for (int i = 1; i < 3; ++i) {
-    if (class_counts[i] > class_counts[max_class_index]) {
-      max_class_index = i;
-    }
+void LitterRobotPresenceDetector::start_enrollment(const std::string &name, uint32_t frames) {
+  if (name.empty() || frames == 0) {
+    ESP_LOGW(TAG, "enrollment needs a name and at least one frame");
+    return;
   }
+  ESP_LOGI(TAG, "enrolling '%s' from the next %u frames with a cat", name.c_str(), (unsigned) frames);
+  this->enrollment_.start(name.c_str(), frames);
+}
 
-  return max_class_index;
-#else
-  // Update EMA for each class
-  double new_values[3] = {0};
-  new_values[max_index] = 1;
+void LitterRobotPresenceDetector::clear_enrollment() {
+  this->enrollment_.clear();
+  this->enrollment_pref_.save(&this->enrollment_.store());
+  this->reset_main_smoother_();
+  ESP_LOGI(TAG, "enrollment cleared, using model classes");
+}
 
-  for (int i = 0; i < 3; ++i) {
-    this->current_predictions[i] =
-        this->ema_alpha * new_values[i] + (1 - this->ema_alpha) * this->current_predictions[i];
+void LitterRobotPresenceDetector::reset_main_smoother_() {
+  // class indices change meaning between model classes and prototypes, and when an eviction shifts the prototypes
+  this->smoother_.reset();
+}
+
+// Maps the model's "some cat" prediction to the nearest enrolled prototype. Enrollment only collects frames where the
+// model sees a cat, so an empty box never becomes a prototype.
+int LitterRobotPresenceDetector::classify_enrolled_(int prediction_index) {
+  if (prediction_index == 0) {
+    return 0;
   }
 
-  // Determine the class with the highest EMA value
-  int max_class_index = 0;
-  for (int i = 1; i < 3; ++i) {
-    if (this->current_predictions[i] > this->current_predictions[max_class_index]) {
-      max_class_index = i;
+  TfLiteTensor *embedding = this->interpreter->output(this->embedding_output_);
+  const int8_t *values = embedding->data.int8;
+  // uint8 embeddings are shifted into int8 by the zero point correction
+  const int32_t zero_point =
+      embedding->type == kTfLiteUInt8 ? embedding->params.zero_point - 128 : embedding->params.zero_point;
+  int8_t shifted[MAX_EMBEDDING_DIM];
+  if (embedding->type == kTfLiteUInt8) {
+    for (size_t i = 0; i < this->enrollment_.dim(); i++) {
+      shifted[i] = static_cast<int8_t>(embedding->data.uint8[i] - 128);
     }
+    values = shifted;
   }
 
-  return max_class_index;
+  if (this->enrollment_.is_collecting()) {
+    bool was_empty = this->enrollment_.size() == 0;
+    bool evicted;
+    if (this->enrollment_.collect(values, zero_point, &evicted)) {
+      this->enrollment_pref_.save(&this->enrollment_.store());
+      ESP_LOGI(TAG, "enrollment done, %u cats enrolled", (unsigned) this->enrollment_.size());
+      if (evicted) {
+        ESP_LOGI(TAG, "oldest prototype evicted, later prototypes moved down one index");
+      }
+      if (was_empty || evicted) {
+        this->reset_main_smoother_();
+      }
+    }
+  }
+
+  float similarity;
+  int nearest = this->enrollment_.classify(values, zero_point, &similarity);
+  if (nearest < 0) {
+    return prediction_index;
+  }
+  ESP_LOGD(TAG, "nearest prototype %s similarity=%.2f", this->enrollment_.name(nearest), similarity);
+  return nearest + 1;
+}
 #endif
+
+int LitterRobotPresenceDetector::decide_state(int max_index) {
+  return this->smooth_(this->smoother_, max_index, this->get_name().c_str());
+}
+
+int LitterRobotPresenceDetector::smooth_(StateSmoother &smoother, int max_index, const char *name) {
+  if (!smoother.accepts(max_index)) {
+    ESP_LOGW(TAG, "'%s': class %d out of range for %u classes, vote dropped", name, max_index,
+             (unsigned) smoother.num_classes());
+  }
+  return smoother.update(max_index);
+}
+
+void LitterRobotPresenceDetector::update_heads_() {
+  for (auto &head : this->heads_) {
+    int prediction_index = this->get_prediction_result(head.output_index);
+    int index_to_update = this->smooth_(head.smoother, prediction_index, head.sensor->get_name().c_str());
+    head.sensor->publish_state(head.classes[index_to_update]);
+  }
+}
+
+std::string LitterRobotPresenceDetector::state_name_(int index) {
+#ifdef USE_ENROLLMENT
+  if (this->enrollment_.size() > 0) {
+    return index == 0 ? CLASSES[0] : std::string(this->enrollment_.name(index - 1));
+  }
+#endif
+  return CLASSES[index];
+}
+
+bool LitterRobotPresenceDetector::setup_heads_() {
+  size_t num_classes = 3;
+#ifdef USE_ENROLLMENT
+  // empty + one class per prototype slot
+  num_classes = std::max(num_classes, MAX_ENROLLED_CATS + 1);
+#endif
+#ifdef USE_EMA
+  this->smoother_.setup(num_classes, SmoothingMode::EMA);
+#else
+  this->smoother_.setup(num_classes, SmoothingMode::SMA, PREDICTION_HISTORY_SIZE);
+#endif
+
+  for (auto &head : this->heads_) {
+    if (head.output_index >= this->interpreter->outputs_size()) {
+      ESP_LOGE(TAG, "model has %u outputs, head '%s' wants output %u", (unsigned) this->interpreter->outputs_size(),
+               head.sensor->get_name().c_str(), (unsigned) head.output_index);
+      return false;
+    }
+    TfLiteTensor *output = this->interpreter->output(head.output_index);
+    size_t num_classes = output->dims->data[output->dims->size - 1];
+    if (num_classes != head.classes.size()) {
+      ESP_LOGE(TAG, "output %u has %u classes, head '%s' lists %u", (unsigned) head.output_index,
+               (unsigned) num_classes, head.sensor->get_name().c_str(), (unsigned) head.classes.size());
+      return false;
+    }
+#ifdef USE_EMA
+    head.smoother.setup(num_classes, SmoothingMode::EMA);
+#else
+    head.smoother.setup(num_classes, SmoothingMode::SMA, PREDICTION_HISTORY_SIZE);
+#endif
+  }
+#ifdef USE_ROIS
+  for (auto &roi : this->rois_) {
+#ifdef USE_EMA
+    roi.smoother.setup(3, SmoothingMode::EMA);
+#else
+    roi.smoother.setup(3, SmoothingMode::SMA, PREDICTION_HISTORY_SIZE);
+#endif
+  }
+#endif
+  return true;
 }
 }  // namespace litter_robot_presence_detector
 }  // namespace esphome
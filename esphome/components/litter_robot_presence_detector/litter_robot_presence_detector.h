@@ -7,13 +7,34 @@
 
 #include "esphome/core/component.h"
 #include "esphome/core/application.h"
+#include "esphome/core/automation.h"
+#include "esphome/core/preferences.h"
 #include "esphome/components/esp32_camera/esp32_camera.h"
+#include "esphome/components/sensor/sensor.h"
 #include "esphome/components/text_sensor/text_sensor.h"
+#include "async_copy.h"
+#include "camera_recovery.h"
+#include "cat_enrollment.h"
+#include "frame_quality.h"
+#include "image_ops.h"
+#include "kernel_benchmark.h"
+#include "logit_scores.h"
+#include "memory_report.h"
+#include "motion_crop.h"
+#include "parallel_jpeg.h"
+#include "preview_gate.h"
+#include "quality_tuner.h"
+#include "remote_inference.h"
+#include "shadow_model.h"
+#include "state_smoother.h"
+#include "thermal_governor.h"
 
 #include <tensorflow/lite/core/c/common.h>
 #include <tensorflow/lite/micro/micro_interpreter.h>
 #include <tensorflow/lite/micro/micro_mutable_op_resolver.h>
+#include <tensorflow/lite/micro/micro_profiler.h>
 #include <string>
+#include <vector>
 
 // #define USE_EMA 1
 
@@ -21,8 +42,45 @@ namespace esphome {
 namespace litter_robot_presence_detector {
 
 constexpr size_t PREDICTION_HISTORY_SIZE = 7;
+// Conv2D, Quantize, LeakyRelu, MaxPool2D, FullyConnected, Reshape, Softmax, Mean
+// + DepthwiseConv2D, Add, Pad, Relu6, AveragePool2D for depthwise-separable models
+constexpr unsigned int OP_RESOLVER_SIZE = 13;
+using OpResolver = tflite::MicroMutableOpResolver<OP_RESOLVER_SIZE>;
 static std::string CLASSES[] = {"empty", "nachi", "ngao"};
 
+struct StageTimings {
+  uint32_t decode_us{0};
+  uint32_t invoke_us{0};
+};
+
+enum class InferResult : uint8_t { DONE, FAILED, SKIPPED };
+
+// Auxiliary classification head read from another output tensor of the same Invoke(), e.g. globe cycling or
+// occluded view, smoothed on its own and published to its own text sensor.
+struct OutputHead {
+  text_sensor::TextSensor *sensor;
+  size_t output_index;
+  std::vector<std::string> classes;
+  StateSmoother smoother;
+};
+
+// Part of the frame classified on its own, e.g. one of two litter boxes side by side. Given in percent of the frame
+// so it survives framesize changes.
+struct RegionOfInterest {
+  text_sensor::TextSensor *sensor;
+  uint8_t x;
+  uint8_t y;
+  uint8_t width;
+  uint8_t height;
+  StateSmoother smoother;
+};
+
+struct SensorRegister {
+  int address;
+  int mask;
+  int value;
+};
+
 class LitterRobotPresenceDetector : public Component, public text_sensor::TextSensor {
  public:
   // constructor
@@ -34,30 +92,276 @@ class LitterRobotPresenceDetector : public Component, public text_sensor::TextSe
   void dump_config() override;
   float get_setup_priority() const override;
 
+#ifdef USE_SPARSE_CONV
+  void set_sparse_max_density(uint8_t sparse_max_density) { this->sparse_max_density_ = sparse_max_density; }
+#endif
+#ifdef USE_WEIGHT_PREFETCH
+  void set_prefetch_buffer_size(size_t prefetch_buffer_size) { this->prefetch_buffer_size_ = prefetch_buffer_size; }
+#endif
+#ifdef USE_TFLM_COMPRESSION
+  void set_decompression_buffer_size(size_t decompression_buffer_size) {
+    this->decompression_buffer_size_ = decompression_buffer_size;
+  }
+#endif
+  void set_skipped_frames_sensor(sensor::Sensor *skipped_frames_sensor) {
+    this->skipped_frames_sensor_ = skipped_frames_sensor;
+  }
+  void set_arena_used_sensor(sensor::Sensor *arena_used_sensor) { this->arena_used_sensor_ = arena_used_sensor; }
+  void set_internal_free_sensor(sensor::Sensor *internal_free_sensor) {
+    this->internal_free_sensor_ = internal_free_sensor;
+  }
+  void set_internal_largest_block_sensor(sensor::Sensor *internal_largest_block_sensor) {
+    this->internal_largest_block_sensor_ = internal_largest_block_sensor;
+  }
+  void set_psram_free_sensor(sensor::Sensor *psram_free_sensor) { this->psram_free_sensor_ = psram_free_sensor; }
+  void set_psram_largest_block_sensor(sensor::Sensor *psram_largest_block_sensor) {
+    this->psram_largest_block_sensor_ = psram_largest_block_sensor;
+  }
+  void set_stack_free_sensor(sensor::Sensor *stack_free_sensor) { this->stack_free_sensor_ = stack_free_sensor; }
+
+  void add_head(text_sensor::TextSensor *sensor, size_t output_index, const std::vector<std::string> &classes) {
+    this->heads_.push_back({sensor, output_index, classes, {}});
+  }
+
+#ifdef USE_ORIENTATION
+  OrientedCopy &get_orientation() { return this->orientation_; }
+#endif
+#ifdef USE_MOTION_CROP
+  MotionCrop &get_motion_crop() { return this->motion_crop_; }
+#endif
+#ifdef USE_ROIS
+  void add_roi(text_sensor::TextSensor *sensor, uint8_t x, uint8_t y, uint8_t width, uint8_t height) {
+    this->rois_.push_back({sensor, x, y, width, height, {}});
+  }
+#endif
+
+#ifdef USE_ENROLLMENT
+  void set_embedding_output(size_t embedding_output) { this->embedding_output_ = embedding_output; }
+  // captures `frames` embeddings of the cat currently in the box as the prototype for `name`
+  void start_enrollment(const std::string &name, uint32_t frames);
+  void clear_enrollment();
+#endif
+
+  // raw sensor register writes applied at setup, e.g. to enable JPEG restart intervals
+  void add_sensor_register(int address, int mask, int value) {
+    this->sensor_registers_.push_back({address, mask, value});
+  }
+#ifdef USE_QUALITY_TUNER
+  QualityTuner &get_quality_tuner() { return this->quality_tuner_; }
+#endif
+#ifdef USE_QUALITY_GATE
+  FrameQualityGate &get_quality_gate() { return this->quality_gate_; }
+#endif
+#ifdef USE_PREVIEW
+  PreviewGate &get_preview_gate() { return this->preview_gate_; }
+  void set_preview_framesize(int preview_framesize) { this->preview_framesize_ = preview_framesize; }
+#endif
+  CameraRecovery &get_camera_recovery() { return this->camera_recovery_; }
+  void set_recovery_time_sensor(sensor::Sensor *recovery_time_sensor) {
+    this->recovery_time_sensor_ = recovery_time_sensor;
+  }
+  void set_recoveries_sensor(sensor::Sensor *recoveries_sensor) { this->recoveries_sensor_ = recoveries_sensor; }
+#ifdef USE_THERMAL_GOVERNOR
+  ThermalGovernor &get_thermal_governor() { return this->thermal_governor_; }
+  void set_chip_temperature_sensor(sensor::Sensor *chip_temperature_sensor) {
+    this->chip_temperature_sensor_ = chip_temperature_sensor;
+  }
+  void set_throttled_time_sensor(sensor::Sensor *throttled_time_sensor) {
+    this->throttled_time_sensor_ = throttled_time_sensor;
+  }
+#endif
+#ifdef USE_REMOTE_INFERENCE
+  RemoteInference &get_remote_inference() { return this->remote_inference_; }
+  void set_offloaded_frames_sensor(sensor::Sensor *offloaded_frames_sensor) {
+    this->offloaded_frames_sensor_ = offloaded_frames_sensor;
+  }
+#endif
+#ifdef USE_SHADOW_MODEL
+  ShadowModel &get_shadow_model() { return this->shadow_model_; }
+  void set_shadow_agreement_sensor(sensor::Sensor *shadow_agreement_sensor) {
+    this->shadow_agreement_sensor_ = shadow_agreement_sensor;
+  }
+  void set_shadow_latency_sensor(sensor::Sensor *shadow_latency_sensor) {
+    this->shadow_latency_sensor_ = shadow_latency_sensor;
+  }
+  void set_shadow_score_delta_sensor(sensor::Sensor *shadow_score_delta_sensor) {
+    this->shadow_score_delta_sensor_ = shadow_score_delta_sensor;
+  }
+#endif
+
  protected:
   std::shared_ptr<esphome::esp32_camera::CameraImage> wait_for_image_();
   SemaphoreHandle_t semaphore_;
   std::shared_ptr<esphome::esp32_camera::CameraImage> image_;
   uint8_t *tensor_arena_{nullptr};
   uint8_t *input_buffer{nullptr};
+  // sized from the input tensor in setup_model()
+  size_t input_buffer_size_{0};
+  // frames that are not a power-of-two multiple of the input are decoded here first, then resized
+  uint8_t *scaled_buffer_{nullptr};
+  size_t scaled_buffer_size_{0};
+  int scaled_width_{0};
+  int scaled_height_{0};
+  bool decode_scaled_(camera_fb_t *rb, esp_jpeg_image_scale_t scale);
   const tflite::Model *model{nullptr};
   tflite::MicroInterpreter *interpreter{nullptr};
+#ifdef USE_OP_PROFILER
+  tflite::MicroProfiler profiler_;
+  uint32_t profiled_frames_{0};
+#endif
+  std::vector<SensorRegister> sensor_registers_;
+#ifdef USE_SPARSE_CONV
+  uint8_t sparse_max_density_{15};
+#endif
+#ifdef USE_WEIGHT_PREFETCH
+  size_t prefetch_buffer_size_{16 * 1024};
+#endif
+#ifdef USE_TFLM_COMPRESSION
+  uint8_t *decompression_buffer_{nullptr};
+  size_t decompression_buffer_size_{32 * 1024};
+#endif
+#ifdef USE_PARALLEL_JPEG
+  ParallelJpegDecoder jpeg_decoder_;
+#endif
+  StageTimings timings_;
+  uint32_t skipped_frames_{0};
+  sensor::Sensor *skipped_frames_sensor_{nullptr};
+  uint32_t last_metrics_publish_{0};
+  void publish_metrics_();
+  sensor::Sensor *arena_used_sensor_{nullptr};
+  sensor::Sensor *internal_free_sensor_{nullptr};
+  sensor::Sensor *internal_largest_block_sensor_{nullptr};
+  sensor::Sensor *psram_free_sensor_{nullptr};
+  sensor::Sensor *psram_largest_block_sensor_{nullptr};
+  sensor::Sensor *stack_free_sensor_{nullptr};
+  bool prefetch_stack_warned_{false};
+  void publish_memory_();
+#ifdef USE_QUALITY_GATE
+  FrameQualityGate quality_gate_;
+#endif
+  uint8_t last_margin_{0};  // top-1 minus top-2 output score of the last frame
+#ifdef USE_LOGITS_OUTPUT
+  LogitsEncoding logits_encoding_{};
+#endif
+#ifdef USE_QUALITY_TUNER
+  QualityTuner quality_tuner_;
+  void apply_quality_step_();
+#endif
+#ifdef USE_PREVIEW
+  PreviewGate preview_gate_;
+  int preview_framesize_{0};
+  uint8_t *preview_buffer_{nullptr};
+  bool handle_preview_(camera_fb_t *rb);
+  void switch_capture_mode_(CaptureMode mode);
+#endif
+#ifdef USE_KERNEL_BENCHMARK
+  bool kernels_benchmarked_{false};
+  KernelBenchmark kernel_benchmark_;
+#endif
+#ifdef USE_ORIENTATION
+  OrientedCopy orientation_;
+  // the decoded frame turned upright, the input tensor is copied from it
+  uint8_t *oriented_buffer_{nullptr};
+#endif
+  AsyncCopy async_copy_;
+  // Returns the frame the tensor receives, after orientation, or nullptr when the tensor is larger than the buffers.
+  // The copy may still be running when it returns, wait on async_copy_ before Invoke().
+  const uint8_t *start_input_copy_(const uint8_t *frame, TfLiteTensor *input);
+#ifdef USE_FULL_FRAME
+  // the whole frame at full resolution, the ROIs and the motion crop are cut from it
+  uint8_t *frame_buffer_{nullptr};
+  size_t frame_buffer_size_{0};
+  int frame_width_{0};
+  int frame_height_{0};
+  bool decode_full_frame_(camera_fb_t *rb);
+#endif
+#ifdef USE_ROIS
+  std::vector<RegionOfInterest> rois_;
+  void update_rois_();
+#endif
+#ifdef USE_MOTION_CROP
+  MotionCrop motion_crop_;
+  // Replaces the whole frame in the input with the moving region cut from a full resolution decode, which is made
+  // here unless `frame_decoded` says frame_buffer_ already holds it.
+  bool apply_motion_crop_(camera_fb_t *rb, bool frame_decoded);
+#endif
+  // the interpreter and arena outlive camera faults, only the camera is brought back
+  CameraRecovery camera_recovery_;
+  sensor::Sensor *recovery_time_sensor_{nullptr};
+  sensor::Sensor *recoveries_sensor_{nullptr};
+  void recover_camera_();
+#ifdef USE_THERMAL_GOVERNOR
+  ThermalGovernor thermal_governor_;
+  sensor::Sensor *chip_temperature_sensor_{nullptr};
+  sensor::Sensor *throttled_time_sensor_{nullptr};
+  uint32_t last_thermal_sample_{0};
+  uint32_t last_frame_start_{0};
+  void apply_thermal_level_();
+#endif
+#ifdef USE_REMOTE_INFERENCE
+  RemoteInference remote_inference_;
+  sensor::Sensor *offloaded_frames_sensor_{nullptr};
+  bool offload_frame_(camera_fb_t *rb);
+#endif
+#ifdef USE_SHADOW_MODEL
+  ShadowModel shadow_model_;
+  sensor::Sensor *shadow_agreement_sensor_{nullptr};
+  sensor::Sensor *shadow_latency_sensor_{nullptr};
+  sensor::Sensor *shadow_score_delta_sensor_{nullptr};
+  // the input of the current frame was captured for the candidate model
+  bool shadow_pending_{false};
+#endif
+  // framesize the model runs at, taken from the camera at setup unless the quality tuner picks it
+  int working_framesize_{-1};
+  // framesize switch in flight: frames of the old size are dropped until the new one arrives
+  int pending_framesize_{-1};
+  uint32_t reconfig_started_{0};
+  uint32_t reconfig_ms_{0};
+  void set_capture_framesize_(int framesize);
+  bool check_frame_size_(camera_fb_t *rb);
 
-#ifndef USE_EMA
-  uint8_t prediction_history[PREDICTION_HISTORY_SIZE] = {0};
-  int last_index{0};
-#else
-  double current_predictions[3] = {0.0, 0.0, 0.0};
-  double ema_alpha{0.2};
+  StateSmoother smoother_;
+#ifdef USE_ENROLLMENT
+  CatEnrollment enrollment_;
+  size_t embedding_output_{1};
+  ESPPreferenceObject enrollment_pref_;
+  bool setup_enrollment_();
+  int classify_enrolled_(int prediction_index);
+  void reset_main_smoother_();
 #endif
+  std::string state_name_(int index);
+  std::vector<OutputHead> heads_;
 
   bool setup_model();
-  bool register_preprocessor_ops(tflite::MicroMutableOpResolver<9> &micro_op_resolver);
-  bool start_infer(std::shared_ptr<esphome::esp32_camera::CameraImage> image);
-  int get_prediction_result();
+  // the shadow model's resolver leaves the weight prefetch wrappers out
+  bool register_preprocessor_ops(OpResolver &micro_op_resolver, bool prefetch_weights = true);
+  InferResult start_infer(std::shared_ptr<esphome::esp32_camera::CameraImage> image);
+  int get_prediction_result(size_t output_index = 0);
   int decide_state(int max_index);
+  // logs and drops a vote the smoother has no class for
+  int smooth_(StateSmoother &smoother, int max_index, const char *name);
+  bool setup_heads_();
+  void update_heads_();
   bool decode_jpg(camera_fb_t *rb);
+  void apply_sensor_registers_();
 };
+#ifdef USE_ENROLLMENT
+template<typename... Ts>
+class EnrollAction : public Action<Ts...>, public Parented<LitterRobotPresenceDetector> {
+ public:
+  TEMPLATABLE_VALUE(std::string, name)
+  TEMPLATABLE_VALUE(uint32_t, frames)
+
+  void play(Ts... x) override { this->parent_->start_enrollment(this->name_.value(x...), this->frames_.value(x...)); }
+};
+
+template<typename... Ts>
+class ClearEnrollmentAction : public Action<Ts...>, public Parented<LitterRobotPresenceDetector> {
+ public:
+  void play(Ts... x) override { this->parent_->clear_enrollment(); }
+};
+#endif
+
 }  // namespace litter_robot_presence_detector
 }  // namespace esphome
 
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+static const size_t MAX_LOGITS = 16;
+
+struct QuantParams {
+  float scale;
+  int32_t zero_point;
+};
+
+// Where the logits end up when the Softmax op is replaced by a copy. The copy writes the logits' raw values into the
+// Softmax output tensor, whose quantization claims they are probabilities; an optional Quantize op then converts
+// them to the model output's encoding as if they were.
+struct LogitsEncoding {
+  QuantParams logits;   // the Softmax input, the only tensor whose parameters describe the values
+  QuantParams softmax;  // the Softmax output
+  QuantParams output;   // the model output, the Softmax output itself when no Quantize follows
+};
+
+// Turns the uint8 model output of the passthrough graph back into the scores the Softmax would have produced, in
+// the model output's encoding, so argmax and top-1/top-2 margins mean the same with and without the passthrough.
+// `scores` may alias `output`. Returns false for more than MAX_LOGITS classes.
+inline bool logits_to_scores(const uint8_t *output, size_t count, const LogitsEncoding &encoding, uint8_t *scores) {
+  if (count == 0 || count > MAX_LOGITS) {
+    return false;
+  }
+  float logits[MAX_LOGITS];
+  float max_logit = 0.0f;
+  for (size_t i = 0; i < count; i++) {
+    // undo the Quantize op, then read the raw value with the logits' own parameters
+    const float requantized = (output[i] - encoding.output.zero_point) * encoding.output.scale / encoding.softmax.scale;
+    const int32_t raw = static_cast<int32_t>(lroundf(requantized)) + encoding.softmax.zero_point;
+    logits[i] = (raw - encoding.logits.zero_point) * encoding.logits.scale;
+    if (i == 0 || logits[i] > max_logit) {
+      max_logit = logits[i];
+    }
+  }
+  float sum = 0.0f;
+  for (size_t i = 0; i < count; i++) {
+    logits[i] = expf(logits[i] - max_logit);
+    sum += logits[i];
+  }
+  for (size_t i = 0; i < count; i++) {
+    const int32_t score = static_cast<int32_t>(lroundf(logits[i] / sum / encoding.output.scale)) +
+                          encoding.output.zero_point;
+    scores[i] = static_cast<uint8_t>(score < 0 ? 0 : score > 255 ? 255 : score);
+  }
+  return true;
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
@@ -0,0 +1,94 @@
+#ifdef USE_ESP32
+#include "logits_passthrough.h"
+
+#include <cstring>
+
+#include "tensorflow/lite/kernels/kernel_util.h"
+#include "tensorflow/lite/micro/kernels/kernel_util.h"
+#include "tensorflow/lite/micro/micro_context.h"
+#include "tensorflow/lite/schema/schema_utils.h"
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+static TfLiteStatus softmax_passthrough_prepare(TfLiteContext *context, TfLiteNode *node) {
+  TF_LITE_ENSURE_EQ(context, tflite::NumInputs(node), 1);
+  TF_LITE_ENSURE_EQ(context, tflite::NumOutputs(node), 1);
+
+  tflite::MicroContext *micro_context = tflite::GetMicroContext(context);
+  TfLiteTensor *input = micro_context->AllocateTempInputTensor(node, 0);
+  TfLiteTensor *output = micro_context->AllocateTempOutputTensor(node, 0);
+  TF_LITE_ENSURE(context, input != nullptr && output != nullptr);
+  TF_LITE_ENSURE_TYPES_EQ(context, input->type, output->type);
+  TF_LITE_ENSURE(context, input->type == kTfLiteInt8 || input->type == kTfLiteUInt8);
+  TF_LITE_ENSURE_EQ(context, tflite::NumElements(input), tflite::NumElements(output));
+
+  micro_context->DeallocateTempTfLiteTensor(input);
+  micro_context->DeallocateTempTfLiteTensor(output);
+  return kTfLiteOk;
+}
+
+static TfLiteStatus softmax_passthrough_eval(TfLiteContext *context, TfLiteNode *node) {
+  const TfLiteEvalTensor *input = tflite::micro::GetEvalInput(context, node, 0);
+  TfLiteEvalTensor *output = tflite::micro::GetEvalOutput(context, node, 0);
+  if (input->data.data != output->data.data) {
+    memcpy(output->data.data, input->data.data, tflite::micro::GetTensorShape(input).FlatSize());
+  }
+  return kTfLiteOk;
+}
+
+TFLMRegistration Register_SOFTMAX_PASSTHROUGH() {
+  return tflite::micro::RegisterOp(nullptr, softmax_passthrough_prepare, softmax_passthrough_eval);
+}
+
+static bool read_quant_params(const tflite::SubGraph *subgraph, int32_t index, QuantParams *params) {
+  if (index < 0 || subgraph->tensors() == nullptr || static_cast<uint32_t>(index) >= subgraph->tensors()->size()) {
+    return false;
+  }
+  const tflite::QuantizationParameters *quantization = subgraph->tensors()->Get(index)->quantization();
+  if (quantization == nullptr || quantization->scale() == nullptr || quantization->zero_point() == nullptr ||
+      quantization->scale()->size() != 1 || quantization->zero_point()->size() != 1) {
+    return false;
+  }
+  params->scale = quantization->scale()->Get(0);
+  params->zero_point = static_cast<int32_t>(quantization->zero_point()->Get(0));
+  return params->scale > 0.0f;
+}
+
+static tflite::BuiltinOperator builtin_code(const tflite::Model *model, const tflite::Operator *op) {
+  return tflite::GetBuiltinCode(model->operator_codes()->Get(op->opcode_index()));
+}
+
+bool find_logits_encoding(const tflite::Model *model, LogitsEncoding *encoding) {
+  if (model->subgraphs() == nullptr || model->subgraphs()->size() == 0 || model->operator_codes() == nullptr) {
+    return false;
+  }
+  const tflite::SubGraph *subgraph = model->subgraphs()->Get(0);
+  if (subgraph->operators() == nullptr || subgraph->outputs() == nullptr || subgraph->outputs()->size() == 0) {
+    return false;
+  }
+  const int32_t model_output = subgraph->outputs()->Get(0);
+
+  for (const tflite::Operator *op : *subgraph->operators()) {
+    if (builtin_code(model, op) != tflite::BuiltinOperator_SOFTMAX || op->inputs()->size() != 1 ||
+        op->outputs()->size() != 1) {
+      continue;
+    }
+    const int32_t softmax_output = op->outputs()->Get(0);
+    bool feeds_output = softmax_output == model_output;
+    for (const tflite::Operator *next : *subgraph->operators()) {
+      feeds_output |= builtin_code(model, next) == tflite::BuiltinOperator_QUANTIZE && next->inputs()->size() == 1 &&
+                      next->inputs()->Get(0) == softmax_output && next->outputs()->Get(0) == model_output;
+    }
+    if (feeds_output) {
+      return read_quant_params(subgraph, op->inputs()->Get(0), &encoding->logits) &&
+             read_quant_params(subgraph, softmax_output, &encoding->softmax) &&
+             read_quant_params(subgraph, model_output, &encoding->output);
+    }
+  }
+  return false;
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+#endif
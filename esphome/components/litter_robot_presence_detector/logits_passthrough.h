@@ -0,0 +1,25 @@
+#pragma once
+
+#ifdef USE_ESP32
+
+#include "logit_scores.h"
+
+#include <tensorflow/lite/micro/micro_common.h>
+#include <tensorflow/lite/schema/schema_generated.h>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+// Stands in for Softmax when only the argmax is used. Softmax is monotonic, so copying the int8 logits to the output
+// keeps the class order while skipping the exp LUT and the normalisation. The copied bytes are logits in the logits
+// tensor's encoding, not the softmax output's; logits_to_scores() rebuilds the scores from them.
+TFLMRegistration Register_SOFTMAX_PASSTHROUGH();
+
+// Reads the quantization of the Softmax input, the Softmax output and the model output from the flatbuffer. Fails
+// unless output 0 is the Softmax output, directly or through one Quantize op.
+bool find_logits_encoding(const tflite::Model *model, LogitsEncoding *encoding);
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+
+#endif
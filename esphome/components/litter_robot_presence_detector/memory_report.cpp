@@ -0,0 +1,27 @@
+#ifdef USE_ESP32
+#include "memory_report.h"
+
+#include <esp_heap_caps.h>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+void sample_memory(TaskHandle_t worker, TaskHandle_t prefetch, MemoryReport *report) {
+  report->internal_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+  report->internal_largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+  report->internal_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+  report->psram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+  report->psram_largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+  // ESP-IDF counts stack depth in bytes
+  report->loop_stack_free = uxTaskGetStackHighWaterMark(nullptr);
+  report->worker_stack_free = worker != nullptr ? uxTaskGetStackHighWaterMark(worker) : 0;
+  report->prefetch_stack_free = prefetch != nullptr ? uxTaskGetStackHighWaterMark(prefetch) : 0;
+  report->worker_priority = worker != nullptr ? uxTaskPriorityGet(worker) : 0;
+  report->prefetch_priority = prefetch != nullptr ? uxTaskPriorityGet(prefetch) : 0;
+  // the core is recorded by the caller, which knows where it pinned the task
+  report->prefetch_core = -1;
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+#endif
@@ -0,0 +1,36 @@
+#pragma once
+
+#ifdef USE_ESP32
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+// Heap and stack snapshot. A free total that stays flat while the largest free block shrinks is fragmentation.
+struct MemoryReport {
+  size_t internal_free;
+  size_t internal_largest_block;
+  size_t internal_min_free;  // low-water mark since boot
+  size_t psram_free;
+  size_t psram_largest_block;
+  uint32_t loop_stack_free;    // bytes never touched on the task running Invoke()
+  uint32_t worker_stack_free;    // same for the dual-core worker, 0 without one
+  uint32_t prefetch_stack_free;  // same for the weight prefetch task, 0 without one
+  // where the helper tasks run: the prefetch copy sits below the worker's priority on the worker's core
+  uint8_t worker_priority;    // 0 without a worker
+  uint8_t prefetch_priority;  // 0 without a prefetch task
+  int8_t prefetch_core;       // -1 without a prefetch task
+};
+
+// Only queries the allocator and FreeRTOS, safe to call from loop() at any rate.
+void sample_memory(TaskHandle_t worker, TaskHandle_t prefetch, MemoryReport *report);
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+
+#endif
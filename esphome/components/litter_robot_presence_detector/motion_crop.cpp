@@ -0,0 +1,114 @@
+#include "motion_crop.h"
+
+#include <algorithm>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+static const int CELL_SIZE = 8;
+// fewer changed cells than this is sensor noise or a flicker, not a cat
+static const int MIN_CHANGED_CELLS = 3;
+
+static inline int rgb_to_luma(const uint8_t *rgb) { return (rgb[0] * 77 + rgb[1] * 150 + rgb[2] * 29) >> 8; }
+
+bool MotionCrop::update(const uint8_t *rgb, int width, int height, int target_width, int target_height, uint32_t now,
+                        CropBox *box) {
+  this->frames_++;
+  CropBox motion;
+  if (this->find_motion_(rgb, width, height, &motion)) {
+    this->fit_box_(width, height, target_width, target_height, &motion);
+    this->last_box_ = motion;
+    this->last_motion_ = now;
+    this->has_box_ = true;
+  } else if (this->has_box_ && now - this->last_motion_ >= this->hold_) {
+    this->has_box_ = false;
+  }
+
+  if (!this->has_box_ || (this->last_box_.width >= width && this->last_box_.height >= height)) {
+    return false;
+  }
+  *box = this->last_box_;
+  this->cropped_frames_++;
+  return true;
+}
+
+bool MotionCrop::find_motion_(const uint8_t *rgb, int width, int height, CropBox *box) {
+  const int grid_width = width / CELL_SIZE;
+  const int grid_height = height / CELL_SIZE;
+  bool first = grid_width != this->grid_width_ || grid_height != this->grid_height_;
+  if (first) {
+    // new framesize, nothing to compare against yet
+    this->grid_width_ = grid_width;
+    this->grid_height_ = grid_height;
+    this->cells_.assign(grid_width * grid_height, 0);
+    this->has_box_ = false;
+  }
+
+  const int stride = width * 3;
+  int changed = 0;
+  int min_x = grid_width, min_y = grid_height, max_x = -1, max_y = -1;
+  uint8_t *cell = this->cells_.data();
+  for (int gy = 0; gy < grid_height; gy++) {
+    const uint8_t *row = rgb + (gy * CELL_SIZE + CELL_SIZE / 4) * stride;
+    for (int gx = 0; gx < grid_width; gx++, cell++) {
+      // four samples per cell, a quarter cell in from each corner
+      const uint8_t *pixel = row + (gx * CELL_SIZE + CELL_SIZE / 4) * 3;
+      const uint8_t *below = pixel + CELL_SIZE / 2 * stride;
+      int luma = (rgb_to_luma(pixel) + rgb_to_luma(pixel + CELL_SIZE / 2 * 3) + rgb_to_luma(below) +
+                  rgb_to_luma(below + CELL_SIZE / 2 * 3)) >>
+                 2;
+      int delta = luma > *cell ? luma - *cell : *cell - luma;
+      *cell = luma;
+      if (delta < this->threshold_) {
+        continue;
+      }
+      changed++;
+      min_x = std::min(min_x, gx);
+      max_x = std::max(max_x, gx);
+      min_y = std::min(min_y, gy);
+      max_y = std::max(max_y, gy);
+    }
+  }
+
+  if (first || changed < MIN_CHANGED_CELLS) {
+    return false;
+  }
+  box->x = min_x * CELL_SIZE;
+  box->y = min_y * CELL_SIZE;
+  box->width = (max_x - min_x + 1) * CELL_SIZE;
+  box->height = (max_y - min_y + 1) * CELL_SIZE;
+  return true;
+}
+
+// grows one side of the box to `size` around its centre and keeps it inside [0, limit)
+static void grow_span(int *start, int *length, int size, int limit) {
+  size = std::min(size, limit);
+  if (size <= *length) {
+    return;
+  }
+  int centre = *start + *length / 2;
+  *start = std::max(0, std::min(centre - size / 2, limit - size));
+  *length = size;
+}
+
+void MotionCrop::fit_box_(int width, int height, int target_width, int target_height, CropBox *box) const {
+  // the margin keeps the still parts of the cat next to the moving ones
+  int margin_x = std::max(CELL_SIZE, box->width * this->margin_ / 100);
+  int margin_y = std::max(CELL_SIZE, box->height * this->margin_ / 100);
+  grow_span(&box->x, &box->width, box->width + 2 * margin_x, width);
+  grow_span(&box->y, &box->height, box->height + 2 * margin_y, height);
+
+  // never smaller than the input, upscaling adds no detail
+  grow_span(&box->x, &box->width, target_width, width);
+  grow_span(&box->y, &box->height, target_height, height);
+
+  // match the input aspect ratio so the crop is not stretched
+  if (box->width * target_height > box->height * target_width) {
+    grow_span(&box->y, &box->height, box->width * target_height / target_width, height);
+  } else {
+    grow_span(&box->x, &box->width, box->height * target_width / target_height, width);
+  }
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
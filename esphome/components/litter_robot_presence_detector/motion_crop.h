@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+struct CropBox {
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
+// Finds the part of the frame worth the model's input resolution. Each frame is reduced to a grid of 8x8 cell
+// lumas, the cells that changed since the previous frame give a bounding box, and the box grows by a margin and to
+// the aspect ratio of the model input. A cat that stops moving keeps the last box for `hold` ms.
+class MotionCrop {
+ public:
+  void set_threshold(uint8_t threshold) { this->threshold_ = threshold; }
+  void set_margin(uint8_t margin) { this->margin_ = margin; }
+  void set_hold(uint32_t hold) { this->hold_ = hold; }
+
+  // Returns false when the whole frame should be used, otherwise the crop in `box`.
+  bool update(const uint8_t *rgb, int width, int height, int target_width, int target_height, uint32_t now,
+              CropBox *box);
+
+  // a box from earlier motion is still applied
+  bool holding() const { return this->has_box_; }
+  uint32_t cropped_frames() const { return this->cropped_frames_; }
+  uint32_t frames() const { return this->frames_; }
+
+ protected:
+  bool find_motion_(const uint8_t *rgb, int width, int height, CropBox *box);
+  void fit_box_(int width, int height, int target_width, int target_height, CropBox *box) const;
+
+  uint8_t threshold_{24};
+  uint8_t margin_{10};
+  uint32_t hold_{30000};
+
+  // cell lumas of the previous frame
+  std::vector<uint8_t> cells_;
+  int grid_width_{0};
+  int grid_height_{0};
+  bool has_box_{false};
+  CropBox last_box_{};
+  uint32_t last_motion_{0};
+  uint32_t frames_{0};
+  uint32_t cropped_frames_{0};
+};
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
@@ -0,0 +1,270 @@
+#ifdef USE_ESP32
+#include "parallel_conv.h"
+#include "conv_band.h"
+#include "dual_core.h"
+
+#include <esp_cpu.h>
+#include <esp_nn.h>
+
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/kernels/internal/reference/integer_ops/conv.h"
+#include "tensorflow/lite/kernels/internal/types.h"
+#include "tensorflow/lite/micro/kernels/conv.h"
+#include "tensorflow/lite/micro/kernels/kernel_util.h"
+#include "tensorflow/lite/micro/micro_context.h"
+#include "tensorflow/lite/micro/micro_log.h"
+
+#include <algorithm>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+struct ParallelConvData {
+  // first member, ConvPrepare reads node->user_data as OpDataConv
+  tflite::OpDataConv conv;
+  int scratch_index;
+  bool split;
+  // ESP-NN keeps its scratch buffer in a global that only the calling core may use, the worker's band runs the
+  // scratch-free ANSI kernel unless the optimized one needs no scratch for it either
+  bool remote_ansi;
+  // output rows at the bottom that run on the worker, moved towards equal band times after every Invoke()
+  int remote_rows;
+};
+
+// Parallel Conv2D layers that split, counted as they are prepared
+static int split_layers = 0;
+
+struct ConvBand {
+  const conv_params_t *params;
+  const quant_data_t *quant;
+  data_dims_t input_dims;
+  data_dims_t filter_dims;
+  data_dims_t output_dims;
+  const int8_t *input;
+  const int8_t *filter;
+  const int32_t *bias;
+  int8_t *output;
+  int row_begin;
+  int row_end;
+  bool ansi;
+  uint32_t cycles;
+};
+
+static conv_params_t esp_nn_conv_params(const TfLiteConvParams &params, const tflite::OpDataConv &data) {
+  conv_params_t conv_params = {};
+  conv_params.in_offset = -data.input_zero_point;
+  conv_params.out_offset = data.output_zero_point;
+  conv_params.stride = {params.stride_width, params.stride_height};
+  conv_params.padding = {data.padding.width, data.padding.height};
+  conv_params.dilation = {0, 0};
+  conv_params.activation = {data.output_activation_min, data.output_activation_max};
+  return conv_params;
+}
+
+// Input slice of output rows [row_begin, row_end), with the top padding moved so each tap lines up with the
+// full-size call. Batched tensors only ever run as one full-height band.
+static void band_dims(const ConvBand &band, data_dims_t *input_dims, data_dims_t *output_dims, int32_t *pad_top,
+                      int *input_offset) {
+  ConvBandRows rows = plan_conv_band(band.row_begin, band.row_end, band.input_dims.height, band.filter_dims.height,
+                                     band.params->stride.height, 1, band.params->padding.height);
+  *input_dims = band.input_dims;
+  input_dims->height = rows.input_end - rows.input_begin;
+  *output_dims = band.output_dims;
+  output_dims->height = band.row_end - band.row_begin;
+  *pad_top = rows.pad_top;
+  *input_offset = rows.input_begin * band.input_dims.width * band.input_dims.channels;
+}
+
+// Runs the ESP-NN kernel for output rows [row_begin, row_end) of every batch.
+static void conv_band(void *arg) {
+  ConvBand *band = static_cast<ConvBand *>(arg);
+  const uint32_t begin = esp_cpu_get_cycle_count();
+  band->cycles = 0;
+  if (band->row_begin >= band->row_end) {
+    return;
+  }
+
+  data_dims_t input_dims;
+  data_dims_t output_dims;
+  int input_offset;
+  conv_params_t params = *band->params;
+  band_dims(*band, &input_dims, &output_dims, &params.padding.height, &input_offset);
+
+  const int input_size = band->input_dims.height * band->input_dims.width * band->input_dims.channels;
+  const int output_size = band->output_dims.height * band->output_dims.width * band->output_dims.channels;
+  const int8_t *input = band->input + input_offset;
+  int8_t *output = band->output + band->row_begin * band->output_dims.width * band->output_dims.channels;
+  for (int batch = 0; batch < band->input_dims.extra; batch++) {
+    if (band->ansi) {
+      esp_nn_conv_s8_ansi(&input_dims, input + batch * input_size, &band->filter_dims, band->filter, band->bias,
+                          &output_dims, output + batch * output_size, &params, band->quant);
+    } else {
+      esp_nn_conv_s8(&input_dims, input + batch * input_size, &band->filter_dims, band->filter, band->bias,
+                     &output_dims, output + batch * output_size, &params, band->quant);
+    }
+  }
+  band->cycles = esp_cpu_get_cycle_count() - begin;
+}
+
+static void *parallel_conv_init(TfLiteContext *context, const char *buffer, size_t length) {
+  TFLITE_DCHECK(context->AllocatePersistentBuffer != nullptr);
+  return context->AllocatePersistentBuffer(context, sizeof(ParallelConvData));
+}
+
+static TfLiteStatus parallel_conv_prepare(TfLiteContext *context, TfLiteNode *node) {
+  TF_LITE_ENSURE_OK(context, tflite::ConvPrepare(context, node));
+
+  auto *data = static_cast<ParallelConvData *>(node->user_data);
+  const auto &params = *(reinterpret_cast<TfLiteConvParams *>(node->builtin_data));
+  data->scratch_index = -1;
+  data->split = false;
+  data->remote_ansi = false;
+  data->remote_rows = 0;
+  if (params.dilation_width_factor != 1 || params.dilation_height_factor != 1) {
+    // ESP-NN has no dilation, eval falls back to the reference kernel
+    return kTfLiteOk;
+  }
+
+  tflite::MicroContext *micro_context = tflite::GetMicroContext(context);
+  TfLiteTensor *input = micro_context->AllocateTempInputTensor(node, tflite::kConvInputTensor);
+  TfLiteTensor *filter = micro_context->AllocateTempInputTensor(node, tflite::kConvWeightsTensor);
+  TfLiteTensor *output = micro_context->AllocateTempOutputTensor(node, tflite::kConvOutputTensor);
+  TF_LITE_ENSURE(context, input != nullptr && filter != nullptr && output != nullptr);
+
+  const conv_params_t conv_params = esp_nn_conv_params(params, data->conv);
+  ConvBand band = {};
+  band.params = &conv_params;
+  band.input_dims = {input->dims->data[2], input->dims->data[1], input->dims->data[3], input->dims->data[0]};
+  band.filter_dims = {filter->dims->data[2], filter->dims->data[1], 0, 0};
+  band.output_dims = {output->dims->data[2], output->dims->data[1], output->dims->data[3], 1};
+
+  int scratch_size = esp_nn_get_conv_scratch_size(&band.input_dims, &band.filter_dims, &band.output_dims,
+                                                  &conv_params);
+  if (scratch_size > 0) {
+    TF_LITE_ENSURE_OK(context, context->RequestScratchBufferInArena(context, scratch_size, &data->scratch_index));
+  }
+
+  const int output_height = band.output_dims.height;
+  data->split = band.input_dims.extra == 1 && output_height >= 2;
+  if (data->split) {
+    // the lower half as a worker band, to see whether the optimized kernel could run there without scratch
+    band.row_begin = output_height / 2;
+    band.row_end = output_height;
+    data_dims_t input_dims;
+    data_dims_t output_dims;
+    conv_params_t band_params = conv_params;
+    int input_offset;
+    band_dims(band, &input_dims, &output_dims, &band_params.padding.height, &input_offset);
+    data->remote_ansi = esp_nn_get_conv_scratch_size(&input_dims, &band.filter_dims, &output_dims, &band_params) > 0;
+    // the ANSI kernel is several times slower than the SIMD one, it starts with a quarter and settles from there
+    data->remote_rows = data->remote_ansi ? std::max(1, output_height / 4) : output_height - output_height / 2;
+    split_layers++;
+  }
+  MicroPrintf("Parallel Conv2D %dx%dx%d -> %dx%dx%d: %s, %d layers split so far", band.input_dims.width,
+              band.input_dims.height, band.input_dims.channels, band.output_dims.width, band.output_dims.height,
+              band.output_dims.channels,
+              !data->split ? "one core" : (data->remote_ansi ? "split, ANSI kernel on the worker" : "split"),
+              split_layers);
+
+  micro_context->DeallocateTempTfLiteTensor(input);
+  micro_context->DeallocateTempTfLiteTensor(filter);
+  micro_context->DeallocateTempTfLiteTensor(output);
+  return kTfLiteOk;
+}
+
+static TfLiteStatus parallel_conv_eval(TfLiteContext *context, TfLiteNode *node) {
+  const TfLiteEvalTensor *input = tflite::micro::GetEvalInput(context, node, tflite::kConvInputTensor);
+  const TfLiteEvalTensor *filter = tflite::micro::GetEvalInput(context, node, tflite::kConvWeightsTensor);
+  const TfLiteEvalTensor *bias =
+      (tflite::NumInputs(node) == 3) ? tflite::micro::GetEvalInput(context, node, tflite::kConvBiasTensor) : nullptr;
+  TfLiteEvalTensor *output = tflite::micro::GetEvalOutput(context, node, tflite::kConvOutputTensor);
+
+  TFLITE_DCHECK(node->builtin_data != nullptr);
+  const auto &params = *(reinterpret_cast<TfLiteConvParams *>(node->builtin_data));
+  TFLITE_DCHECK(node->user_data != nullptr);
+  auto &data = *(static_cast<ParallelConvData *>(node->user_data));
+
+  if (input->type != kTfLiteInt8 || filter->type != kTfLiteInt8) {
+    MicroPrintf("Parallel Conv2D: input type %s, filter type %s not supported.", TfLiteTypeGetName(input->type),
+                TfLiteTypeGetName(filter->type));
+    return kTfLiteError;
+  }
+
+#ifdef USE_TFLM_COMPRESSION
+  // compressed weights are expanded into the interpreter's decompression memory before the split
+  tflite::MicroContext *micro_context = tflite::GetMicroContext(context);
+  const tflite::CompressionTensorData *weights_comp_td =
+      micro_context->GetTensorCompressionData(node, tflite::kConvWeightsTensor);
+  const tflite::CompressionTensorData *bias_comp_td =
+      micro_context->GetTensorCompressionData(node, tflite::kConvBiasTensor);
+  const int8_t *filter_data =
+      tflite::micro::GetTensorData<int8_t>(micro_context, filter, weights_comp_td, data.conv.weights_scratch_index);
+  const int32_t *bias_data =
+      tflite::micro::GetOptionalTensorData<int32_t>(micro_context, bias, bias_comp_td, data.conv.bias_scratch_index);
+#else
+  const int8_t *filter_data = tflite::micro::GetTensorData<int8_t>(filter);
+  const int32_t *bias_data = tflite::micro::GetOptionalTensorData<int32_t>(bias);
+#endif
+
+  const tflite::RuntimeShape input_shape = tflite::micro::GetTensorShape(input);
+  const tflite::RuntimeShape filter_shape = tflite::micro::GetTensorShape(filter);
+  const tflite::RuntimeShape output_shape = tflite::micro::GetTensorShape(output);
+
+  if (params.dilation_width_factor != 1 || params.dilation_height_factor != 1) {
+    tflite::reference_integer_ops::ConvPerChannel(
+        tflite::ConvParamsQuantized(params, data.conv), data.conv.per_channel_output_multiplier,
+        data.conv.per_channel_output_shift, input_shape, tflite::micro::GetTensorData<int8_t>(input), filter_shape,
+        filter_data, tflite::micro::GetTensorShape(bias), bias_data, output_shape,
+        tflite::micro::GetTensorData<int8_t>(output));
+    return kTfLiteOk;
+  }
+
+  const conv_params_t conv_params = esp_nn_conv_params(params, data.conv);
+  const quant_data_t quant_data = {.shift = data.conv.per_channel_output_shift,
+                                   .mult = data.conv.per_channel_output_multiplier};
+  ConvBand local = {
+      .params = &conv_params,
+      .quant = &quant_data,
+      .input_dims = {input_shape.Dims(2), input_shape.Dims(1), input_shape.Dims(3), input_shape.Dims(0)},
+      .filter_dims = {filter_shape.Dims(2), filter_shape.Dims(1), 0, 0},
+      .output_dims = {output_shape.Dims(2), output_shape.Dims(1), output_shape.Dims(3), 1},
+      .input = tflite::micro::GetTensorData<int8_t>(input),
+      .filter = filter_data,
+      .bias = bias_data,
+      .output = tflite::micro::GetTensorData<int8_t>(output),
+      .row_begin = 0,
+      .row_end = output_shape.Dims(1),
+      .ansi = false,
+      .cycles = 0,
+  };
+  // only the calling core's band ever reads ESP-NN's global scratch buffer
+  if (data.scratch_index >= 0) {
+    esp_nn_set_conv_scratch_buf(context->GetScratchBuffer(context, data.scratch_index));
+  }
+
+  if (!data.split || global_dual_core_worker == nullptr || !global_dual_core_worker->is_running()) {
+    conv_band(&local);
+    return kTfLiteOk;
+  }
+
+  ConvBand remote = local;
+  local.row_end = local.output_dims.height - data.remote_rows;
+  remote.row_begin = local.row_end;
+  remote.ansi = data.remote_ansi;
+  global_dual_core_worker->run(conv_band, &local, &remote);
+  // one row at a time towards the split where both cores finish together
+  if (remote.cycles > local.cycles && data.remote_rows > 1) {
+    data.remote_rows--;
+  } else if (remote.cycles < local.cycles && data.remote_rows < local.output_dims.height - 1) {
+    data.remote_rows++;
+  }
+  return kTfLiteOk;
+}
+
+TFLMRegistration Register_PARALLEL_CONV_2D() {
+  return tflite::micro::RegisterOp(parallel_conv_init, parallel_conv_prepare, parallel_conv_eval);
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+#endif
@@ -0,0 +1,20 @@
+#pragma once
+
+#ifdef USE_ESP32
+
+#include <tensorflow/lite/micro/micro_common.h>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+// int8 Conv2D that splits the output rows between the calling core and the dual core worker. Each band runs an
+// ESP-NN kernel, so results are bit-exact with the stock ESP-NN Conv2D. ESP-NN's scratch buffer is a single global,
+// so only the calling core uses it; where a band needs scratch (every layer on the ESP32-S3) the worker runs the
+// scratch-free ANSI kernel on a smaller band, and the split moves a row per Invoke() towards equal band times.
+// Dilated layers run unsplit on the reference kernel. Prepare logs each layer's choice and the split count.
+TFLMRegistration Register_PARALLEL_CONV_2D();
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+
+#endif
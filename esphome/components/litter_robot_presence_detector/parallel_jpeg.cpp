@@ -0,0 +1,90 @@
+#ifdef USE_ESP32
+#include "parallel_jpeg.h"
+#include "dual_core.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+
+#include <cinttypes>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+static const char *const TAG = "litter_robot_presence_detector.jpeg";
+
+struct JpegHalf {
+  esp_jpeg_image_cfg_t cfg;
+  esp_err_t result;
+};
+
+static void decode_half(void *arg) {
+  auto *half = static_cast<JpegHalf *>(arg);
+  esp_jpeg_image_output_t outimg;
+  half->result = esp_jpeg_decode(&half->cfg, &outimg);
+}
+
+bool ParallelJpegDecoder::reserve_scratch_(size_t size) {
+  if (size <= this->scratch_size_) {
+    return true;
+  }
+  ExternalRAMAllocator<uint8_t> allocator(ExternalRAMAllocator<uint8_t>::ALLOW_FAILURE);
+  if (this->scratch_ != nullptr) {
+    allocator.deallocate(this->scratch_, this->scratch_size_);
+  }
+  this->scratch_ = allocator.allocate(size);
+  this->scratch_size_ = this->scratch_ == nullptr ? 0 : size;
+  return this->scratch_ != nullptr;
+}
+
+esp_err_t ParallelJpegDecoder::decode(const uint8_t *data, size_t len, esp_jpeg_image_scale_t scale,
+                                      uint8_t *outbuf, size_t outbuf_size) {
+  JpegLayout layout;
+  if (global_dual_core_worker == nullptr || !global_dual_core_worker->is_running() ||
+      !parse_jpeg_layout(data, len, &layout)) {
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+
+  JpegSplit split;
+  if (!plan_jpeg_split(data, len, layout, &split)) {
+    if (split.split_row != 0) {
+      ESP_LOGW(TAG, "restart marker %" PRIu32 " not found", split.split_marker);
+    }
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+  if (!this->reserve_scratch_(split.top_len + split.bottom_len)) {
+    ESP_LOGE(TAG, "could not allocate split buffer");
+    return ESP_ERR_NO_MEM;
+  }
+  uint8_t *top = this->scratch_;
+  uint8_t *bottom = this->scratch_ + split.top_len;
+  write_jpeg_halves(data, len, layout, split, top, bottom);
+
+  const size_t row_bytes = (layout.width >> scale) * 3;
+  const size_t top_bytes = (split.top_height >> scale) * row_bytes;
+  if (top_bytes + (split.bottom_height >> scale) * row_bytes > outbuf_size) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  JpegHalf halves[2];
+  for (int i = 0; i < 2; i++) {
+    halves[i].cfg = {.indata = i == 0 ? top : bottom,
+                     .indata_size = i == 0 ? split.top_len : split.bottom_len,
+                     .outbuf = i == 0 ? outbuf : outbuf + top_bytes,
+                     .outbuf_size = i == 0 ? top_bytes : outbuf_size - top_bytes,
+                     .out_format = JPEG_IMAGE_FORMAT_RGB888,
+                     .out_scale = scale,
+                     .flags = {
+                         .swap_color_bytes = 0,
+                     }};
+    halves[i].result = ESP_FAIL;
+  }
+
+  global_dual_core_worker->run(decode_half, &halves[0], &halves[1]);
+  if (halves[0].result != ESP_OK) {
+    return halves[0].result;
+  }
+  return halves[1].result;
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+#endif
@@ -0,0 +1,34 @@
+#pragma once
+
+#ifdef USE_ESP32
+
+#include <cstddef>
+#include <cstdint>
+
+#include "jpeg_decoder.h"
+#include "jpeg_layout.h"
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+// Splits a baseline JPEG at the RSTn marker closest to the middle MCU row and decodes the two halves on both cores
+// into disjoint rows of the output buffer. Each half becomes a standalone stream: the headers are copied with the
+// frame height patched, and the bottom half's RST markers are renumbered to start from RST0.
+class ParallelJpegDecoder {
+ public:
+  // Returns ESP_ERR_NOT_SUPPORTED when the frame has no restart interval that lands on an MCU row boundary, the
+  // caller is expected to fall back to a serial esp_jpeg_decode().
+  esp_err_t decode(const uint8_t *data, size_t len, esp_jpeg_image_scale_t scale, uint8_t *outbuf,
+                   size_t outbuf_size);
+
+ protected:
+  bool reserve_scratch_(size_t size);
+
+  uint8_t *scratch_{nullptr};
+  size_t scratch_size_{0};
+};
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+
+#endif
@@ -0,0 +1,60 @@
+#include "preview_gate.h"
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+// background follows the scene with weight 1/2^BACKGROUND_SHIFT per frame
+static const int BACKGROUND_SHIFT = 3;
+// changed pixels are blended in too, only slower, so a moved object or new lighting is absorbed after a few dozen
+// preview frames instead of keeping the gate open forever
+static const int CHANGED_BACKGROUND_SHIFT = 6;
+
+static inline uint8_t rgb_to_luma(const uint8_t *rgb) { return (rgb[0] * 77 + rgb[1] * 150 + rgb[2] * 29) >> 8; }
+
+bool PreviewGate::detect_change(const uint8_t *rgb, int width, int height) {
+  const size_t pixels = width * height;
+  if (this->background_.size() != pixels) {
+    // first frame or new preview size, learn it as the empty scene
+    this->background_.resize(pixels);
+    for (size_t i = 0; i < pixels; i++) {
+      this->background_[i] = rgb_to_luma(rgb + i * 3);
+    }
+    return false;
+  }
+
+  size_t changed = 0;
+  for (size_t i = 0; i < pixels; i++) {
+    int luma = rgb_to_luma(rgb + i * 3);
+    int delta = luma - this->background_[i];
+    if (delta > this->pixel_threshold_ || -delta > this->pixel_threshold_) {
+      changed++;
+      // at least one level per frame, a plain shift would never move small steps
+      int step = 1 + ((delta > 0 ? delta : -delta) >> CHANGED_BACKGROUND_SHIFT);
+      this->background_[i] += delta > 0 ? step : -step;
+    } else {
+      this->background_[i] += delta >> BACKGROUND_SHIFT;
+    }
+  }
+
+  return changed * 100 >= pixels * this->changed_percent_;
+}
+
+bool PreviewGate::update_decision(bool empty) {
+  if (this->mode_ != CaptureMode::WORKING) {
+    return false;
+  }
+  this->empty_streak_ = empty ? this->empty_streak_ + 1 : 0;
+  return this->empty_streak_ >= this->empty_frames_;
+}
+
+void PreviewGate::set_mode(CaptureMode mode) {
+  if (mode == CaptureMode::PREVIEW && this->mode_ == CaptureMode::WORKING) {
+    // the model just saw an empty box for empty_frames in a row, whatever the scene looks like now is the background
+    this->background_.clear();
+  }
+  this->mode_ = mode;
+  this->empty_streak_ = 0;
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+enum class CaptureMode : uint8_t { PREVIEW, WORKING };
+
+// Cheap occupancy check for the preview resolution. A slowly learned luma background of the empty litter box is
+// compared with every preview frame; enough changed pixels switch the camera to the working resolution. The gate
+// drops back to preview once the smoothed decision has been "empty" for a number of frames.
+class PreviewGate {
+ public:
+  void set_pixel_threshold(uint8_t pixel_threshold) { this->pixel_threshold_ = pixel_threshold; }
+  void set_changed_percent(uint8_t changed_percent) { this->changed_percent_ = changed_percent; }
+  void set_empty_frames(uint32_t empty_frames) { this->empty_frames_ = empty_frames; }
+
+  // Feeds a decoded RGB888 preview frame. Returns true when the scene changed enough to run the model.
+  bool detect_change(const uint8_t *rgb, int width, int height);
+  // Feeds one smoothed decision at working resolution. Returns true when it is time to drop back to preview.
+  bool update_decision(bool empty);
+
+  CaptureMode mode() const { return this->mode_; }
+  void set_mode(CaptureMode mode);
+
+ protected:
+  uint8_t pixel_threshold_{24};
+  uint8_t changed_percent_{3};
+  uint32_t empty_frames_{20};
+
+  CaptureMode mode_{CaptureMode::PREVIEW};
+  uint32_t empty_streak_{0};
+  std::vector<uint8_t> background_;
+};
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
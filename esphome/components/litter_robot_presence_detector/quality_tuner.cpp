@@ -0,0 +1,89 @@
+#include "quality_tuner.h"
+
+#include <algorithm>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+// share of frames in a window whose margin must clear the threshold
+static const uint32_t STABLE_PERCENT = 90;
+// stable windows after which a previously failing step is tried again
+static const uint32_t FLOOR_RELAX_WINDOWS = 30;
+
+void QualityTuner::setup() {
+  this->ladder_.clear();
+  for (int framesize : this->framesizes_) {
+    for (int quality = this->worst_quality_; quality >= this->best_quality_; quality -= this->quality_step_) {
+      this->ladder_.push_back({framesize, static_cast<uint8_t>(quality), 0});
+      if (this->quality_step_ == 0) {
+        break;
+      }
+    }
+  }
+  this->index_ = this->ladder_.empty() ? 0 : std::min(this->ladder_.size() - 1, this->ceiling_);
+  this->floor_ = 0;
+}
+
+bool QualityTuner::set_ceiling(size_t ceiling) {
+  this->ceiling_ = ceiling;
+  if (this->index_ <= ceiling) {
+    return false;
+  }
+  this->index_ = ceiling;
+  this->floor_ = std::min(this->floor_, ceiling);
+  this->frames_ = 0;
+  this->stable_frames_ = 0;
+  this->decode_sum_us_ = 0;
+  return true;
+}
+
+bool QualityTuner::update(uint8_t margin, uint32_t decode_us) {
+  if (this->ladder_.empty()) {
+    return false;
+  }
+
+  this->frames_++;
+  this->decode_sum_us_ += decode_us;
+  if (margin >= this->margin_threshold_) {
+    this->stable_frames_++;
+  }
+  if (this->frames_ < this->window_) {
+    return false;
+  }
+
+  QualityStep &step = this->ladder_[this->index_];
+  step.avg_decode_us = this->decode_sum_us_ / this->frames_;
+  bool stable = this->stable_frames_ * 100 >= this->frames_ * STABLE_PERCENT;
+  this->frames_ = 0;
+  this->stable_frames_ = 0;
+  this->decode_sum_us_ = 0;
+
+  if (!stable) {
+    this->stable_windows_ = 0;
+    if (this->index_ + 1 < this->ladder_.size() && this->index_ < this->ceiling_) {
+      this->floor_ = this->index_ + 1;
+      this->index_++;
+      return true;
+    }
+    return false;
+  }
+
+  if (++this->stable_windows_ >= FLOOR_RELAX_WINDOWS && this->floor_ > 0) {
+    this->floor_--;
+    this->stable_windows_ = 0;
+  }
+
+  if (this->index_ > this->floor_) {
+    const QualityStep &cheaper = this->ladder_[this->index_ - 1];
+    // a cheaper step that was measured and did not decode faster is not worth the accuracy risk
+    if (cheaper.avg_decode_us != 0 && cheaper.avg_decode_us >= step.avg_decode_us) {
+      return false;
+    }
+    this->index_--;
+    return true;
+  }
+  return false;
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
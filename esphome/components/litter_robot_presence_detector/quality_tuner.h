@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+struct QualityStep {
+  int framesize;          // esp32-camera framesize_t
+  uint8_t jpeg_quality;   // esp32-camera scale, higher is smaller and lower quality
+  uint32_t avg_decode_us; // measured while the step was active, 0 until then
+};
+
+// Walks a ladder of (framesize, jpeg quality) steps ordered from cheapest to most expensive. After every window of
+// classified frames it steps down while the top-1/top-2 score margin stays above the threshold, and steps back up
+// (remembering the failing step as a floor) as soon as margins get unstable.
+class QualityTuner {
+ public:
+  void add_framesize(int framesize) { this->framesizes_.push_back(framesize); }
+  void set_quality_range(uint8_t best, uint8_t worst, uint8_t step) {
+    this->best_quality_ = best;
+    this->worst_quality_ = worst;
+    this->quality_step_ = step;
+  }
+  void set_margin_threshold(uint8_t margin_threshold) { this->margin_threshold_ = margin_threshold; }
+  void set_window(uint32_t window) { this->window_ = window; }
+
+  // Builds the ladder and starts at the most expensive step.
+  void setup();
+  // Feeds one classified frame. Returns true when the active step changed and should be applied to the sensor.
+  bool update(uint8_t margin, uint32_t decode_us);
+
+  // Caps the ladder at step `ceiling`, e.g. while the chip is too hot. Returns true when the active step had to
+  // move down and should be applied to the sensor.
+  bool set_ceiling(size_t ceiling);
+
+  const QualityStep &current() const { return this->ladder_[this->index_]; }
+  size_t current_index() const { return this->index_; }
+  size_t size() const { return this->ladder_.size(); }
+  bool empty() const { return this->ladder_.empty(); }
+
+ protected:
+  std::vector<int> framesizes_;
+  std::vector<QualityStep> ladder_;
+  uint8_t best_quality_{10};
+  uint8_t worst_quality_{40};
+  uint8_t quality_step_{5};
+  uint8_t margin_threshold_{64};
+  uint32_t window_{20};
+
+  size_t index_{0};
+  size_t floor_{0};
+  size_t ceiling_{SIZE_MAX};
+  uint32_t frames_{0};
+  uint32_t stable_frames_{0};
+  uint32_t stable_windows_{0};
+  uint64_t decode_sum_us_{0};
+};
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
@@ -0,0 +1,198 @@
+#ifdef USE_ESP32
+#include "remote_inference.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+static const char *const TAG = "litter_robot_presence_detector.remote";
+static const size_t RESPONSE_SIZE = 64;
+// TLS handshakes for https URLs need most of it
+static const uint32_t REQUEST_STACK_SIZE = 8192;
+// share moved per published result, ten results from all local to all remote
+static const uint8_t OFFLOAD_STEP_PERCENT = 10;
+
+bool RemoteInference::setup() {
+  esp_http_client_config_t config = {};
+  config.url = this->url_.c_str();
+  config.method = HTTP_METHOD_POST;
+  // bounds each blocking call of the task, infer() enforces the overall deadline
+  config.timeout_ms = this->timeout_ms_;
+  config.keep_alive_enable = true;
+  this->client_ = esp_http_client_init(&config);
+  if (this->client_ == nullptr) {
+    ESP_LOGE(TAG, "Could not create HTTP client for %s", this->url_.c_str());
+    return false;
+  }
+  esp_http_client_set_header(this->client_, "Content-Type", "image/jpeg");
+
+  this->start_ = xSemaphoreCreateBinary();
+  this->done_ = xSemaphoreCreateBinary();
+  if (this->start_ == nullptr || this->done_ == nullptr) {
+    ESP_LOGE(TAG, "failed to create request semaphores");
+    return false;
+  }
+  if (xTaskCreate(RemoteInference::request_task_, "lr_remote", REQUEST_STACK_SIZE, this, uxTaskPriorityGet(nullptr),
+                  &this->task_) != pdPASS) {
+    ESP_LOGE(TAG, "failed to create request task");
+    this->task_ = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void RemoteInference::record_result_age(uint32_t age_us) {
+  const uint8_t max_percent = 100 - 100 / this->probe_interval_;
+  if (age_us > this->latency_budget_us_) {
+    this->offload_percent_ = std::min<uint32_t>(this->offload_percent_ + OFFLOAD_STEP_PERCENT, max_percent);
+  } else {
+    this->offload_percent_ =
+        this->offload_percent_ > OFFLOAD_STEP_PERCENT ? this->offload_percent_ - OFFLOAD_STEP_PERCENT : 0;
+  }
+}
+
+bool RemoteInference::should_offload() {
+  if (this->task_ == nullptr || this->busy_) {
+    return false;
+  }
+  this->credit_ += this->offload_percent_;
+  if (this->credit_ < 100) {
+    return false;
+  }
+  this->credit_ -= 100;
+  return true;
+}
+
+bool RemoteInference::infer(const uint8_t *jpeg, size_t len, uint8_t *scores, size_t num_scores) {
+  if (this->task_ == nullptr || this->busy_ || num_scores > MAX_SCORES) {
+    return false;
+  }
+  // the camera buffer goes back before a late request is done with it, so the task sends its own copy
+  if (len > this->jpeg_capacity_) {
+    ExternalRAMAllocator<uint8_t> allocator(ExternalRAMAllocator<uint8_t>::ALLOW_FAILURE);
+    if (this->jpeg_ != nullptr) {
+      allocator.deallocate(this->jpeg_, this->jpeg_capacity_);
+    }
+    this->jpeg_capacity_ = 0;
+    this->jpeg_ = allocator.allocate(len);
+    if (this->jpeg_ == nullptr) {
+      ESP_LOGW(TAG, "no memory for a %u byte frame", (unsigned) len);
+      return false;
+    }
+    this->jpeg_capacity_ = len;
+  }
+  memcpy(this->jpeg_, jpeg, len);
+  this->jpeg_len_ = len;
+  this->num_scores_ = num_scores;
+
+  // a late request gave done_ before it cleared busy_, that completion belongs to an older frame
+  xSemaphoreTake(this->done_, 0);
+  uint32_t start = millis();
+  this->busy_ = true;
+  xSemaphoreGive(this->start_);
+  bool ok = xSemaphoreTake(this->done_, pdMS_TO_TICKS(this->timeout_ms_)) == pdTRUE;
+  if (!ok) {
+    ESP_LOGW(TAG, "no scores within %u ms", (unsigned) this->timeout_ms_);
+  }
+  if (!ok || !this->ok_) {
+    // back off, the share regrows while results stay late
+    this->offload_percent_ /= 2;
+    this->fallbacks_++;
+    return false;
+  }
+  memcpy(scores, this->scores_, num_scores);
+  this->offloaded_frames_++;
+  ESP_LOGD(TAG, "remote scores in %u ms", (unsigned) (millis() - start));
+  return true;
+}
+
+void RemoteInference::request_task_(void *param) {
+  auto *remote = static_cast<RemoteInference *>(param);
+  while (true) {
+    xSemaphoreTake(remote->start_, portMAX_DELAY);
+    remote->ok_ = remote->request_();
+    if (!remote->ok_) {
+      // drop the connection so the next request does not read a stale response
+      esp_http_client_close(remote->client_);
+    }
+    xSemaphoreGive(remote->done_);
+    remote->busy_ = false;
+  }
+}
+
+bool RemoteInference::request_() {
+  esp_err_t err = esp_http_client_open(this->client_, this->jpeg_len_);
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "connect failed: %s", esp_err_to_name(err));
+    return false;
+  }
+  if (esp_http_client_write(this->client_, reinterpret_cast<const char *>(this->jpeg_), this->jpeg_len_) !=
+      (int) this->jpeg_len_) {
+    ESP_LOGW(TAG, "sending the frame failed");
+    return false;
+  }
+  if (esp_http_client_fetch_headers(this->client_) < 0) {
+    ESP_LOGW(TAG, "no response");
+    return false;
+  }
+  int status = esp_http_client_get_status_code(this->client_);
+  if (status != 200) {
+    ESP_LOGW(TAG, "server answered %d", status);
+    return false;
+  }
+  char body[RESPONSE_SIZE];
+  int read = esp_http_client_read_response(this->client_, body, sizeof(body) - 1);
+  if (read <= 0) {
+    ESP_LOGW(TAG, "empty response");
+    return false;
+  }
+  // the rest would be read as the next response on the kept-alive connection
+  if (!esp_http_client_is_complete_data_received(this->client_)) {
+    ESP_LOGW(TAG, "response longer than %u bytes", (unsigned) (sizeof(body) - 1));
+    return false;
+  }
+  body[read] = '\0';
+  return this->parse_scores_(body, read);
+}
+
+bool RemoteInference::parse_scores_(const char *body, size_t len) {
+  auto is_separator = [](char c) { return c == ',' || isspace((unsigned char) c); };
+  size_t count = 0;
+  size_t i = 0;
+  while (i < len) {
+    if (is_separator(body[i])) {
+      i++;
+      continue;
+    }
+    // every token is a whole number, "0.5" or "-3" rejects the response instead of splitting into two scores
+    uint32_t value = 0;
+    size_t digits = 0;
+    for (; i < len && !is_separator(body[i]); i++) {
+      if (body[i] < '0' || body[i] > '9' || ++digits > 3) {
+        ESP_LOGW(TAG, "unexpected response '%s'", body);
+        return false;
+      }
+      value = value * 10 + (body[i] - '0');
+    }
+    if (value > 255 || count == this->num_scores_) {
+      ESP_LOGW(TAG, "unexpected response '%s'", body);
+      return false;
+    }
+    this->scores_[count++] = value;
+  }
+  if (count != this->num_scores_) {
+    ESP_LOGW(TAG, "got %u scores, expected %u", (unsigned) count, (unsigned) this->num_scores_);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+#endif
@@ -0,0 +1,78 @@
+#pragma once
+
+#ifdef USE_ESP32
+
+#include <esp_http_client.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+// Posts the JPEG frame to an inference server on the LAN for a share of frames while results are published later
+// than the latency budget. The server answers with one 0-255 score per class, separated by commas or whitespace,
+// e.g. "3,240,12".
+class RemoteInference {
+ public:
+  static const size_t MAX_SCORES = 16;
+
+  void set_url(const std::string &url) { this->url_ = url; }
+  void set_timeout(uint32_t timeout_ms) { this->timeout_ms_ = timeout_ms; }
+  void set_latency_budget(uint32_t latency_budget_ms) { this->latency_budget_us_ = latency_budget_ms * 1000; }
+  // at least every n-th frame runs locally, so the device keeps producing results while the server is used
+  void set_probe_interval(uint32_t probe_interval) { this->probe_interval_ = probe_interval; }
+
+  bool setup();
+  // Capture to publish time of a frame, local or remote. Above the budget the offloaded share grows, below it shrinks.
+  void record_result_age(uint32_t age_us);
+  bool should_offload();
+  // Waits at most the timeout, connect and transfer included; true only when `num_scores` scores arrived by then.
+  // A request that misses the deadline finishes on its task and is dropped, no frame is offloaded until it has.
+  bool infer(const uint8_t *jpeg, size_t len, uint8_t *scores, size_t num_scores);
+
+  const std::string &url() const { return this->url_; }
+  uint8_t offload_percent() const { return this->offload_percent_; }
+  uint32_t offloaded_frames() const { return this->offloaded_frames_; }
+  uint32_t fallbacks() const { return this->fallbacks_; }
+
+ protected:
+  static void request_task_(void *param);
+  bool request_();
+  bool parse_scores_(const char *body, size_t len);
+
+  std::string url_;
+  uint32_t timeout_ms_{300};
+  uint32_t latency_budget_us_{1000000};
+  uint32_t probe_interval_{10};
+
+  esp_http_client_handle_t client_{nullptr};
+  TaskHandle_t task_{nullptr};
+  SemaphoreHandle_t start_{nullptr};
+  SemaphoreHandle_t done_{nullptr};
+  // set by infer(), cleared by the task once the request, late or not, has finished
+  std::atomic<bool> busy_{false};
+
+  // owned by the task while busy_
+  uint8_t *jpeg_{nullptr};
+  size_t jpeg_capacity_{0};
+  size_t jpeg_len_{0};
+  uint8_t scores_[MAX_SCORES];
+  size_t num_scores_{0};
+  bool ok_{false};
+
+  uint8_t offload_percent_{0};
+  uint32_t credit_{0};
+  uint32_t offloaded_frames_{0};
+  uint32_t fallbacks_{0};
+};
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+
+#endif
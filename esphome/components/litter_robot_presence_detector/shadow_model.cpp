@@ -0,0 +1,149 @@
+#ifdef USE_ESP32
+#include "shadow_model.h"
+#include "logits_passthrough.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+
+#include "tensorflow/lite/schema/schema_generated.h"
+
+#include <cstring>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+static const char *const TAG = "litter_robot_presence_detector.shadow";
+// flatbuffers need aligned scalars, progmem arrays only guarantee byte alignment
+static const size_t MODEL_ALIGNMENT = 16;
+
+static int argmax(const TfLiteTensor *output, size_t count) {
+  int max_index = 0;
+  for (size_t i = 1; i < count; ++i) {
+    if (output->data.uint8[i] > output->data.uint8[max_index]) {
+      max_index = i;
+    }
+  }
+  return max_index;
+}
+
+bool ShadowModel::setup(const tflite::MicroOpResolver &op_resolver) {
+  ExternalRAMAllocator<uint8_t> allocator(ExternalRAMAllocator<uint8_t>::ALLOW_FAILURE);
+  const uint8_t *model_data = this->model_data_;
+  if (reinterpret_cast<uintptr_t>(model_data) % MODEL_ALIGNMENT != 0) {
+    this->model_copy_ = allocator.allocate(this->model_size_ + MODEL_ALIGNMENT);
+    if (this->model_copy_ == nullptr) {
+      ESP_LOGE(TAG, "Could not allocate a copy of the shadow model.");
+      return false;
+    }
+    const size_t misalignment = reinterpret_cast<uintptr_t>(this->model_copy_) % MODEL_ALIGNMENT;
+    uint8_t *start = this->model_copy_ + (misalignment == 0 ? 0 : MODEL_ALIGNMENT - misalignment);
+    memcpy(start, this->model_data_, this->model_size_);
+    model_data = start;
+  }
+
+  const tflite::Model *model = ::tflite::GetModel(model_data);
+  if (model->version() != TFLITE_SCHEMA_VERSION) {
+    ESP_LOGE(TAG, "Shadow model is schema version %d, expected %d", model->version(), TFLITE_SCHEMA_VERSION);
+    this->reset();
+    return false;
+  }
+
+  this->arena_ = allocator.allocate(this->arena_size_);
+  if (this->arena_ == nullptr) {
+    ESP_LOGE(TAG, "Could not allocate the shadow model's tensor arena.");
+    this->reset();
+    return false;
+  }
+
+  this->interpreter_ = new tflite::MicroInterpreter(model, op_resolver, this->arena_, this->arena_size_);  // NOLINT
+  if (this->interpreter_->AllocateTensors() != kTfLiteOk) {
+    ESP_LOGE(TAG, "Shadow AllocateTensors() failed");
+    this->reset();
+    return false;
+  }
+#ifdef USE_LOGITS_OUTPUT
+  if (this->interpreter_->output(0)->type != kTfLiteUInt8 || !find_logits_encoding(model, &this->logits_encoding_)) {
+    ESP_LOGE(TAG, "Shadow output 0 is not a uint8 Softmax output");
+    this->reset();
+    return false;
+  }
+#endif
+
+  ESP_LOGD(TAG, "shadow model ready, arena used %u bytes", (unsigned) this->interpreter_->arena_used_bytes());
+  return true;
+}
+
+void ShadowModel::reset() {
+  delete this->interpreter_;  // NOLINT
+  this->interpreter_ = nullptr;
+  ExternalRAMAllocator<uint8_t> allocator(ExternalRAMAllocator<uint8_t>::ALLOW_FAILURE);
+  if (this->arena_ != nullptr) {
+    allocator.deallocate(this->arena_, this->arena_size_);
+    this->arena_ = nullptr;
+  }
+  if (this->model_copy_ != nullptr) {
+    allocator.deallocate(this->model_copy_, this->model_size_ + MODEL_ALIGNMENT);
+    this->model_copy_ = nullptr;
+  }
+}
+
+bool ShadowModel::should_run() {
+  if (!this->enabled()) {
+    return false;
+  }
+  this->credit_ += this->sample_percent_;
+  if (this->credit_ < 100) {
+    return false;
+  }
+  this->credit_ -= 100;
+  return true;
+}
+
+bool ShadowModel::capture(const TfLiteTensor *primary_input) {
+  TfLiteTensor *input = this->interpreter_->input(0);
+  if (input->bytes != primary_input->bytes) {
+    ESP_LOGW(TAG, "shadow input is %u bytes, primary %u", (unsigned) input->bytes, (unsigned) primary_input->bytes);
+    return false;
+  }
+  memcpy(input->data.uint8, primary_input->data.uint8, input->bytes);
+  return true;
+}
+
+bool ShadowModel::run(const TfLiteTensor *primary_output) {
+  uint32_t prior_invoke = micros();
+  if (this->interpreter_->Invoke() != kTfLiteOk) {
+    ESP_LOGW(TAG, "shadow Invoke() failed");
+    return false;
+  }
+  uint32_t latency_us = micros() - prior_invoke;
+
+  TfLiteTensor *output = this->interpreter_->output(0);
+#ifdef USE_LOGITS_OUTPUT
+  // compared like the primary output, as scores the Softmax would have produced
+  logits_to_scores(output->data.uint8, output->bytes, this->logits_encoding_, output->data.uint8);
+#endif
+  if (output->bytes != primary_output->bytes) {
+    ESP_LOGW(TAG, "shadow output has %u scores, primary %u", (unsigned) output->bytes,
+             (unsigned) primary_output->bytes);
+    return false;
+  }
+
+  uint32_t delta = 0;
+  for (size_t i = 0; i < output->bytes; i++) {
+    int diff = output->data.uint8[i] - primary_output->data.uint8[i];
+    delta += diff < 0 ? -diff : diff;
+  }
+
+  int shadow_class = argmax(output, output->bytes);
+  int primary_class = argmax(primary_output, primary_output->bytes);
+  this->frames_++;
+  this->agreements_ += shadow_class == primary_class ? 1 : 0;
+  this->latency_sum_us_ += latency_us;
+  this->delta_sum_ += delta / output->bytes;
+  ESP_LOGD(TAG, "shadow class %d primary class %d, latency=%u us", shadow_class, primary_class, (unsigned) latency_us);
+  return true;
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+#endif
@@ -0,0 +1,70 @@
+#pragma once
+
+#ifdef USE_ESP32
+
+#include "logit_scores.h"
+
+#include <tensorflow/lite/core/c/common.h>
+#include <tensorflow/lite/micro/micro_interpreter.h>
+#include <tensorflow/lite/micro/micro_op_resolver.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+// Runs a candidate model next to the production one on a fraction of frames, on the exact input tensor the
+// production model saw (after orientation, crop or ROI), and only records how it compares. It never feeds
+// decide_state().
+class ShadowModel {
+ public:
+  void set_model(const uint8_t *model_data, size_t model_size) {
+    this->model_data_ = model_data;
+    this->model_size_ = model_size;
+  }
+  void set_sample_percent(uint8_t sample_percent) { this->sample_percent_ = sample_percent; }
+  void set_arena_size(size_t arena_size) { this->arena_size_ = arena_size; }
+
+  // On failure everything it allocated is freed again and the shadow model stays disabled.
+  bool setup(const tflite::MicroOpResolver &op_resolver);
+  // Frees the interpreter, arena and model copy; should_run() is false afterwards.
+  void reset();
+  bool enabled() const { return this->interpreter_ != nullptr; }
+  // Spreads the sampled frames evenly instead of drawing random numbers.
+  bool should_run();
+  // Copies the production model's input tensor, call it before the production Invoke() may overwrite it.
+  bool capture(const TfLiteTensor *primary_input);
+  // Invokes the shadow model on the captured input and compares the output with the primary output.
+  bool run(const TfLiteTensor *primary_output);
+
+  uint32_t frames() const { return this->frames_; }
+  float agreement_percent() const { return this->frames_ == 0 ? 0.0f : this->agreements_ * 100.0f / this->frames_; }
+  float mean_latency_ms() const { return this->frames_ == 0 ? 0.0f : this->latency_sum_us_ / 1000.0f / this->frames_; }
+  // mean absolute difference of the 8-bit output scores
+  float mean_score_delta() const { return this->frames_ == 0 ? 0.0f : (float) this->delta_sum_ / this->frames_; }
+
+ protected:
+  const uint8_t *model_data_{nullptr};
+  size_t model_size_{0};
+  uint8_t sample_percent_{10};
+  size_t arena_size_{200 * 1024};
+
+  tflite::MicroInterpreter *interpreter_{nullptr};
+  // aligned copy of the model, only when model_data_ was not aligned
+  uint8_t *model_copy_{nullptr};
+  uint8_t *arena_{nullptr};
+  uint32_t credit_{0};
+  uint32_t frames_{0};
+  uint32_t agreements_{0};
+  uint64_t latency_sum_us_{0};
+  uint64_t delta_sum_{0};
+#ifdef USE_LOGITS_OUTPUT
+  LogitsEncoding logits_encoding_{};
+#endif
+};
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+static const int SPARSE_BLOCK = 4;
+
+struct SparseBlock {
+  uint16_t channel;  // first input channel of the block
+  uint8_t filter_y;
+  uint8_t filter_x;
+};
+
+// Non-zero blocks of a dense OHWI int8 filter: blocks of output channel c are [channel_start[c], channel_start[c + 1]).
+struct SparseFilter {
+  const SparseBlock *blocks;
+  const uint32_t *channel_start;
+  int block_size;
+};
+
+inline int sparse_block_size(int input_depth) { return input_depth % SPARSE_BLOCK == 0 ? SPARSE_BLOCK : 1; }
+
+inline bool sparse_block_is_zero(const int8_t *weights, int block_size) {
+  for (int i = 0; i < block_size; i++) {
+    if (weights[i] != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline uint32_t count_sparse_blocks(const int8_t *weights, int weight_count, int block_size) {
+  uint32_t non_zero = 0;
+  for (int offset = 0; offset < weight_count; offset += block_size) {
+    if (!sparse_block_is_zero(weights + offset, block_size)) {
+      non_zero++;
+    }
+  }
+  return non_zero;
+}
+
+// Fills blocks (count_sparse_blocks() entries) and channel_start (output_depth + 1 entries).
+inline void build_sparse_blocks(const int8_t *weights, int output_depth, int filter_height, int filter_width, int depth,
+                                int block_size, SparseBlock *blocks, uint32_t *channel_start) {
+  const int channel_stride = filter_height * filter_width * depth;
+  uint32_t index = 0;
+  for (int out_channel = 0; out_channel < output_depth; out_channel++) {
+    channel_start[out_channel] = index;
+    for (int filter_y = 0; filter_y < filter_height; filter_y++) {
+      for (int filter_x = 0; filter_x < filter_width; filter_x++) {
+        for (int channel = 0; channel < depth; channel += block_size) {
+          int offset = out_channel * channel_stride + (filter_y * filter_width + filter_x) * depth + channel;
+          if (!sparse_block_is_zero(weights + offset, block_size)) {
+            blocks[index++] = {static_cast<uint16_t>(channel), static_cast<uint8_t>(filter_y),
+                               static_cast<uint8_t>(filter_x)};
+          }
+        }
+      }
+    }
+  }
+  channel_start[output_depth] = index;
+}
+
+// Accumulator of one output pixel and channel over the non-zero blocks only, before bias and requantization.
+// in_y_origin/in_x_origin are the input position of filter tap (0, 0), taps outside the input are padding.
+inline int32_t sparse_accumulate(const SparseFilter &filter, int out_channel, const int8_t *channel_filter,
+                                 int filter_width, const int8_t *input, int input_height, int input_width,
+                                 int input_depth, int in_y_origin, int in_x_origin, int dilation_height,
+                                 int dilation_width, int32_t input_offset) {
+  int32_t acc = 0;
+  for (uint32_t b = filter.channel_start[out_channel]; b < filter.channel_start[out_channel + 1]; b++) {
+    const SparseBlock &block = filter.blocks[b];
+    const int in_y = in_y_origin + dilation_height * block.filter_y;
+    const int in_x = in_x_origin + dilation_width * block.filter_x;
+    if (in_y < 0 || in_y >= input_height || in_x < 0 || in_x >= input_width) {
+      continue;
+    }
+    const int8_t *in = input + (in_y * input_width + in_x) * input_depth + block.channel;
+    const int8_t *weights = channel_filter + (block.filter_y * filter_width + block.filter_x) * input_depth +
+                            block.channel;
+    for (int i = 0; i < filter.block_size; i++) {
+      acc += weights[i] * (in[i] + input_offset);
+    }
+  }
+  return acc;
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
@@ -0,0 +1,220 @@
+#ifdef USE_ESP32
+#include "sparse_conv.h"
+#include "dual_core.h"
+#include "sparse_blocks.h"
+
+#include <algorithm>
+
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/kernels/internal/common.h"
+#include "tensorflow/lite/kernels/kernel_util.h"
+#include "tensorflow/lite/micro/kernels/conv.h"
+#include "tensorflow/lite/micro/kernels/kernel_util.h"
+#include "tensorflow/lite/micro/micro_context.h"
+#include "tensorflow/lite/micro/micro_log.h"
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+struct SparseOpData {
+  tflite::OpDataConv conv;  // first member, ConvPrepare() fills it through node->user_data
+  SparseFilter filter;
+  // user_data of the dense registration, which runs the layer when `dense` is set
+  void *dense_data;
+  bool dense;
+};
+
+// kernel for layers too dense to gain from skipping blocks
+static TFLMRegistration dense_registration = {};
+static uint8_t max_density_percent = 100;
+
+struct SparseBand {
+  const SparseOpData *data;
+  const TfLiteConvParams *params;
+  int input_height;
+  int input_width;
+  int input_depth;
+  int filter_width;
+  int filter_channel_stride;
+  int output_width;
+  int output_depth;
+  const int8_t *input;
+  const int8_t *filter;
+  const int32_t *bias;
+  int8_t *output;
+  int row_begin;
+  int row_end;
+};
+
+static void *sparse_conv_init(TfLiteContext *context, const char *buffer, size_t length) {
+  auto *data = static_cast<SparseOpData *>(context->AllocatePersistentBuffer(context, sizeof(SparseOpData)));
+  if (data == nullptr) {
+    return nullptr;
+  }
+  data->dense_data =
+      dense_registration.init != nullptr ? dense_registration.init(context, buffer, length) : nullptr;
+  data->dense = false;
+  return data;
+}
+
+// Runs a dense registration callback with its own user_data in place.
+static TfLiteStatus call_dense(TfLiteStatus (*fn)(TfLiteContext *, TfLiteNode *), TfLiteContext *context,
+                               TfLiteNode *node) {
+  void *data = node->user_data;
+  node->user_data = static_cast<SparseOpData *>(data)->dense_data;
+  TfLiteStatus status = fn(context, node);
+  node->user_data = data;
+  return status;
+}
+
+static TfLiteStatus sparse_conv_prepare(TfLiteContext *context, TfLiteNode *node) {
+  auto *data = static_cast<SparseOpData *>(node->user_data);
+
+  tflite::MicroContext *micro_context = tflite::GetMicroContext(context);
+  TfLiteTensor *input = micro_context->AllocateTempInputTensor(node, tflite::kConvInputTensor);
+  TfLiteTensor *filter = micro_context->AllocateTempInputTensor(node, tflite::kConvWeightsTensor);
+  TF_LITE_ENSURE(context, input != nullptr && filter != nullptr);
+  TF_LITE_ENSURE_TYPES_EQ(context, filter->type, kTfLiteInt8);
+  TF_LITE_ENSURE(context, filter->data.int8 != nullptr);
+
+  const int output_depth = tflite::SizeOfDimension(filter, 0);
+  const int filter_height = tflite::SizeOfDimension(filter, 1);
+  const int filter_width = tflite::SizeOfDimension(filter, 2);
+  const int depth = tflite::SizeOfDimension(filter, 3);
+  // grouped convolutions keep the dense kernel
+  TF_LITE_ENSURE_EQ(context, depth, tflite::SizeOfDimension(input, 3));
+
+  const int block_size = sparse_block_size(depth);
+  const int8_t *weights = filter->data.int8;
+  const int channel_stride = filter_height * filter_width * depth;
+  const uint32_t non_zero = count_sparse_blocks(weights, output_depth * channel_stride, block_size);
+  const int total = output_depth * channel_stride / block_size;
+
+  data->dense = non_zero * 100 > (uint32_t) total * max_density_percent;
+  MicroPrintf("Sparse Conv2D %dx%dx%dx%d: %d/%d blocks of %d non-zero, %s kernel", output_depth, filter_height,
+              filter_width, depth, (int) non_zero, total, block_size, data->dense ? "dense" : "sparse");
+  if (data->dense) {
+    micro_context->DeallocateTempTfLiteTensor(input);
+    micro_context->DeallocateTempTfLiteTensor(filter);
+    return call_dense(dense_registration.prepare, context, node);
+  }
+  TF_LITE_ENSURE_OK(context, tflite::ConvPrepare(context, node));
+
+  auto *channel_start = static_cast<uint32_t *>(
+      context->AllocatePersistentBuffer(context, (output_depth + 1) * sizeof(uint32_t)));
+  auto *blocks = static_cast<SparseBlock *>(
+      context->AllocatePersistentBuffer(context, std::max<uint32_t>(non_zero, 1) * sizeof(SparseBlock)));
+  TF_LITE_ENSURE(context, channel_start != nullptr && blocks != nullptr);
+  build_sparse_blocks(weights, output_depth, filter_height, filter_width, depth, block_size, blocks, channel_start);
+  data->filter = {blocks, channel_start, block_size};
+
+  micro_context->DeallocateTempTfLiteTensor(input);
+  micro_context->DeallocateTempTfLiteTensor(filter);
+  return kTfLiteOk;
+}
+
+static void sparse_conv_band(void *arg) {
+  const SparseBand *band = static_cast<const SparseBand *>(arg);
+  const SparseOpData *data = band->data;
+  const tflite::OpDataConv &conv = data->conv;
+  const TfLiteConvParams *params = band->params;
+  const int32_t input_offset = -conv.input_zero_point;
+
+  for (int out_y = band->row_begin; out_y < band->row_end; out_y++) {
+    const int in_y_origin = out_y * params->stride_height - conv.padding.height;
+    for (int out_x = 0; out_x < band->output_width; out_x++) {
+      const int in_x_origin = out_x * params->stride_width - conv.padding.width;
+      int8_t *out = band->output + (out_y * band->output_width + out_x) * band->output_depth;
+
+      for (int out_channel = 0; out_channel < band->output_depth; out_channel++) {
+        const int8_t *channel_filter = band->filter + out_channel * band->filter_channel_stride;
+        int32_t acc = sparse_accumulate(data->filter, out_channel, channel_filter, band->filter_width, band->input,
+                                        band->input_height, band->input_width, band->input_depth, in_y_origin,
+                                        in_x_origin, params->dilation_height_factor, params->dilation_width_factor,
+                                        input_offset);
+
+        if (band->bias != nullptr) {
+          acc += band->bias[out_channel];
+        }
+        acc = tflite::MultiplyByQuantizedMultiplier(acc, conv.per_channel_output_multiplier[out_channel],
+                                                    conv.per_channel_output_shift[out_channel]);
+        acc += conv.output_zero_point;
+        acc = std::max(acc, conv.output_activation_min);
+        acc = std::min(acc, conv.output_activation_max);
+        out[out_channel] = static_cast<int8_t>(acc);
+      }
+    }
+  }
+}
+
+static TfLiteStatus sparse_conv_eval(TfLiteContext *context, TfLiteNode *node) {
+  const TfLiteEvalTensor *input = tflite::micro::GetEvalInput(context, node, tflite::kConvInputTensor);
+  const TfLiteEvalTensor *filter = tflite::micro::GetEvalInput(context, node, tflite::kConvWeightsTensor);
+  const TfLiteEvalTensor *bias =
+      (tflite::NumInputs(node) == 3) ? tflite::micro::GetEvalInput(context, node, tflite::kConvBiasTensor) : nullptr;
+  TfLiteEvalTensor *output = tflite::micro::GetEvalOutput(context, node, tflite::kConvOutputTensor);
+
+  TFLITE_DCHECK(node->builtin_data != nullptr);
+  TFLITE_DCHECK(node->user_data != nullptr);
+  const auto *data = static_cast<const SparseOpData *>(node->user_data);
+  if (data->dense) {
+    return call_dense(dense_registration.invoke, context, node);
+  }
+
+  if (input->type != kTfLiteInt8) {
+    MicroPrintf("Sparse Conv2D: input type %s not supported.", TfLiteTypeGetName(input->type));
+    return kTfLiteError;
+  }
+
+  const tflite::RuntimeShape input_shape = tflite::micro::GetTensorShape(input);
+  const tflite::RuntimeShape filter_shape = tflite::micro::GetTensorShape(filter);
+  const tflite::RuntimeShape output_shape = tflite::micro::GetTensorShape(output);
+  const int batches = input_shape.Dims(0);
+  const int output_height = output_shape.Dims(1);
+
+  SparseBand local = {
+      .data = data,
+      .params = reinterpret_cast<const TfLiteConvParams *>(node->builtin_data),
+      .input_height = input_shape.Dims(1),
+      .input_width = input_shape.Dims(2),
+      .input_depth = input_shape.Dims(3),
+      .filter_width = filter_shape.Dims(2),
+      .filter_channel_stride = filter_shape.Dims(1) * filter_shape.Dims(2) * filter_shape.Dims(3),
+      .output_width = output_shape.Dims(2),
+      .output_depth = output_shape.Dims(3),
+      .input = tflite::micro::GetTensorData<int8_t>(input),
+      .filter = tflite::micro::GetTensorData<int8_t>(filter),
+      .bias = tflite::micro::GetOptionalTensorData<int32_t>(bias),
+      .output = tflite::micro::GetTensorData<int8_t>(output),
+      .row_begin = 0,
+      .row_end = output_height,
+  };
+
+  const bool split = output_height >= 2 && global_dual_core_worker != nullptr && global_dual_core_worker->is_running();
+  const int input_batch_size = local.input_height * local.input_width * local.input_depth;
+  const int output_batch_size = output_height * local.output_width * local.output_depth;
+  for (int batch = 0; batch < batches; batch++) {
+    if (!split) {
+      sparse_conv_band(&local);
+    } else {
+      SparseBand top = local;
+      SparseBand bottom = local;
+      top.row_end = output_height / 2;
+      bottom.row_begin = top.row_end;
+      global_dual_core_worker->run(sparse_conv_band, &top, &bottom);
+    }
+    local.input += input_batch_size;
+    local.output += output_batch_size;
+  }
+  return kTfLiteOk;
+}
+
+TFLMRegistration Register_SPARSE_CONV_2D(const TFLMRegistration &dense, uint8_t max_density) {
+  dense_registration = dense;
+  max_density_percent = max_density;
+  return tflite::micro::RegisterOp(sparse_conv_init, sparse_conv_prepare, sparse_conv_eval);
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+#ifdef USE_ESP32
+
+#include <tensorflow/lite/micro/micro_common.h>
+
+#include <cstdint>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+// int8 Conv2D for pruned models. At Prepare the dense filter is scanned once and every output channel gets a list of
+// its non-zero blocks (4 consecutive input channels at one filter tap, or single weights when the input depth is not
+// a multiple of 4). Eval only visits those blocks, so the cost scales with the density of the pruned filter. Rows are
+// split across both cores when the dual core worker runs. Requantization matches the reference kernel bit for bit.
+// A layer with more than max_density_percent of its blocks non-zero runs the `dense` registration instead; Prepare
+// logs the choice per layer.
+TFLMRegistration Register_SPARSE_CONV_2D(const TFLMRegistration &dense, uint8_t max_density_percent);
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+
+#endif
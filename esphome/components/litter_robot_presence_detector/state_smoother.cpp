@@ -0,0 +1,74 @@
+#include "state_smoother.h"
+
+#include <algorithm>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+void StateSmoother::setup(size_t num_classes, SmoothingMode mode, size_t window, double alpha) {
+  this->num_classes_ = num_classes;
+  this->mode_ = mode;
+  this->alpha_ = alpha;
+  this->history_.assign(mode == SmoothingMode::SMA ? window : 0, 0);
+  this->class_counts_.assign(num_classes, 0);
+  this->averages_.assign(mode == SmoothingMode::EMA ? num_classes : 0, 0.0);
+  this->last_index_ = 0;
+  this->last_state_ = 0;
+}
+
+void StateSmoother::reset() {
+  std::fill(this->history_.begin(), this->history_.end(), 0);
+  std::fill(this->averages_.begin(), this->averages_.end(), 0.0);
+  this->last_index_ = 0;
+  this->last_state_ = 0;
+}
+
+int StateSmoother::update(int max_index) {
+  if (this->num_classes_ == 0) {
+    return 0;
+  }
+  // the vote indexes the tallies
+  if (!this->accepts(max_index)) {
+    return this->last_state_;
+  }
+
+  int max_class_index = 0;
+  if (this->mode_ == SmoothingMode::SMA) {
+    // Update prediction history
+    this->history_[this->last_index_] = max_index;
+    this->last_index_ += 1;
+    if (this->last_index_ == this->history_.size()) {
+      this->last_index_ = 0;
+    }
+
+    // Count votes for each class over the window
+    std::fill(this->class_counts_.begin(), this->class_counts_.end(), 0);
+    for (uint8_t vote : this->history_) {
+      this->class_counts_[vote] += 1;
+    }
+
+    for (size_t i = 1; i < this->num_classes_; ++i) {
+      if (this->class_counts_[i] > this->class_counts_[max_class_index]) {
+        max_class_index = i;
+      }
+    }
+  } else {
+    // Update EMA for each class with a one-hot vote
+    for (size_t i = 0; i < this->num_classes_; ++i) {
+      double vote = static_cast<int>(i) == max_index ? 1.0 : 0.0;
+      this->averages_[i] = this->alpha_ * vote + (1 - this->alpha_) * this->averages_[i];
+    }
+
+    for (size_t i = 1; i < this->num_classes_; ++i) {
+      if (this->averages_[i] > this->averages_[max_class_index]) {
+        max_class_index = i;
+      }
+    }
+  }
+
+  this->last_state_ = max_class_index;
+  return max_class_index;
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+enum class SmoothingMode : uint8_t { SMA, EMA };
+
+// Temporal smoothing of per-frame argmax votes. SMA takes the majority of the last `window` votes, EMA keeps an
+// exponential moving average of one-hot votes. Both start out favouring class 0 and break ties towards the lower
+// class index.
+class StateSmoother {
+ public:
+  void setup(size_t num_classes, SmoothingMode mode, size_t window = 7, double alpha = 0.2);
+  // Feeds one frame's argmax, returns the smoothed class index. An index outside [0, num_classes) is not recorded
+  // and returns the previous smoothed index.
+  int update(int max_index);
+  bool accepts(int max_index) const { return max_index >= 0 && static_cast<size_t>(max_index) < this->num_classes_; }
+  void reset();
+
+  size_t num_classes() const { return this->num_classes_; }
+
+ protected:
+  size_t num_classes_{0};
+  SmoothingMode mode_{SmoothingMode::SMA};
+  double alpha_{0.2};
+
+  std::vector<uint8_t> history_;
+  size_t last_index_{0};
+  int last_state_{0};
+  std::vector<uint8_t> class_counts_;
+  std::vector<double> averages_;
+};
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
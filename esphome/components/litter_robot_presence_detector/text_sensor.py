@@ -1,10 +1,38 @@
+from esphome import automation
+import esphome.final_validate as fv
 import esphome.codegen as cg
 import esphome.config_validation as cv
-from esphome.components import esp32, text_sensor
-from esphome.const import CONF_ID, CONF_SENSOR_ID
+from esphome.core import CORE, HexInt
+from esphome.components import esp32, sensor, text_sensor
+from esphome.const import (
+    CONF_ADDRESS,
+    CONF_FILE,
+    CONF_HEIGHT,
+    CONF_ID,
+    CONF_NAME,
+    CONF_RAW_DATA_ID,
+    CONF_SENSOR_ID,
+    CONF_TEMPERATURE,
+    CONF_THRESHOLD,
+    CONF_TIMEOUT,
+    CONF_URL,
+    CONF_VALUE,
+    CONF_WIDTH,
+    CONF_X,
+    CONF_Y,
+    DEVICE_CLASS_TEMPERATURE,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_BYTES,
+    UNIT_CELSIUS,
+    UNIT_MILLISECOND,
+    UNIT_PERCENT,
+    UNIT_SECOND,
+)
 
 DEPENDENCIES = ["esp32_camera"]
-AUTO_LOAD = ["text_sensor"]
+AUTO_LOAD = ["sensor", "text_sensor"]
 
 litter_robot_presence_detector_ns = cg.esphome_ns.namespace(
     "litter_robot_presence_detector"
@@ -13,10 +41,342 @@ LitterRobotPresenceDetectorConstructor = litter_robot_presence_detector_ns.class
     "LitterRobotPresenceDetector", cg.Component, text_sensor.TextSensor
 )
 
+EnrollAction = litter_robot_presence_detector_ns.class_(
+    "EnrollAction", automation.Action
+)
+ClearEnrollmentAction = litter_robot_presence_detector_ns.class_(
+    "ClearEnrollmentAction", automation.Action
+)
+
 # MULTI_CONF = True
 CONF_USE_EMA = "use_ema"
+CONF_PARALLEL_CONV = "parallel_conv"
+CONF_PARALLEL_JPEG = "parallel_jpeg"
+CONF_SPARSE_CONV = "sparse_conv"
+CONF_SPARSE_MAX_DENSITY = "sparse_max_density"
+CONF_PROFILE_OPS = "profile_ops"
+CONF_KERNEL_BENCHMARK = "kernel_benchmark"
+CONF_MEMORY = "memory"
+CONF_WEIGHT_PREFETCH = "weight_prefetch"
+CONF_BUFFER_SIZE = "buffer_size"
+CONF_THERMAL = "thermal"
+CONF_CAMERA_RECOVERY = "camera_recovery"
+CONF_MAX_BACKOFF = "max_backoff"
+CONF_TIME_TO_RECOVERY = "time_to_recovery"
+CONF_RECOVERIES = "recoveries"
+CONF_WARM_THRESHOLD = "warm_threshold"
+CONF_HOT_THRESHOLD = "hot_threshold"
+CONF_HYSTERESIS = "hysteresis"
+CONF_WARM_FRAME_DELAY = "warm_frame_delay"
+CONF_HOT_FRAME_DELAY = "hot_frame_delay"
+CONF_THROTTLED_TIME = "throttled_time"
+CONF_ARENA_USED = "arena_used"
+CONF_INTERNAL_FREE = "internal_free"
+CONF_INTERNAL_LARGEST_BLOCK = "internal_largest_block"
+CONF_PSRAM_FREE = "psram_free"
+CONF_PSRAM_LARGEST_BLOCK = "psram_largest_block"
+CONF_STACK_FREE = "stack_free"
+CONF_ARGMAX_ONLY = "argmax_only"
+CONF_HEADS = "heads"
+CONF_OUTPUT = "output"
+CONF_CLASSES = "classes"
+CONF_ENROLLMENT = "enrollment"
+CONF_EMBEDDING_OUTPUT = "embedding_output"
+CONF_FRAMES = "frames"
+CONF_SENSOR_REGISTERS = "sensor_registers"
+CONF_MASK = "mask"
+CONF_QUALITY_TUNER = "quality_tuner"
+CONF_FRAMESIZES = "framesizes"
+CONF_BEST_QUALITY = "best_quality"
+CONF_WORST_QUALITY = "worst_quality"
+CONF_QUALITY_STEP = "quality_step"
+CONF_MARGIN_THRESHOLD = "margin_threshold"
+CONF_WINDOW = "window"
+CONF_PREVIEW = "preview"
+CONF_FRAMESIZE = "framesize"
+CONF_PIXEL_THRESHOLD = "pixel_threshold"
+CONF_CHANGED_PERCENT = "changed_percent"
+CONF_EMPTY_FRAMES = "empty_frames"
+CONF_QUALITY_GATE = "quality_gate"
+CONF_MAX_DARK_PERCENT = "max_dark_percent"
+CONF_MAX_SATURATED_PERCENT = "max_saturated_percent"
+CONF_MIN_GRADIENT = "min_gradient"
+CONF_SKIPPED_FRAMES = "skipped_frames"
+CONF_COMPRESSED_WEIGHTS = "compressed_weights"
+CONF_DECOMPRESSION_BUFFER_SIZE = "decompression_buffer_size"
+CONF_SHADOW_MODEL = "shadow_model"
+CONF_SAMPLE_PERCENT = "sample_percent"
+CONF_ARENA_SIZE = "arena_size"
+CONF_AGREEMENT = "agreement"
+CONF_LATENCY = "latency"
+CONF_SCORE_DELTA = "score_delta"
+CONF_REMOTE_INFERENCE = "remote_inference"
+CONF_ROIS = "rois"
+CONF_MOTION_CROP = "motion_crop"
+CONF_MARGIN = "margin"
+CONF_HOLD = "hold"
+CONF_ROTATION = "rotation"
+CONF_MIRROR = "mirror"
+CONF_LATENCY_BUDGET = "latency_budget"
+CONF_PROBE_INTERVAL = "probe_interval"
+CONF_OFFLOADED_FRAMES = "offloaded_frames"
+
+# esp32-camera framesize_t, must not exceed the resolution the camera was set up with
+FRAMESIZES = {
+    "QQVGA": "FRAMESIZE_QQVGA",
+    "QCIF": "FRAMESIZE_QCIF",
+    "HQVGA": "FRAMESIZE_HQVGA",
+    "QVGA": "FRAMESIZE_QVGA",
+    "CIF": "FRAMESIZE_CIF",
+    "VGA": "FRAMESIZE_VGA",
+}
+
+SENSOR_REGISTER_SCHEMA = cv.Schema(
+    {
+        cv.Required(CONF_ADDRESS): cv.hex_uint16_t,
+        cv.Required(CONF_VALUE): cv.hex_uint8_t,
+        cv.Optional(CONF_MASK, default=0xFF): cv.hex_uint8_t,
+    }
+)
+
+QUALITY_TUNER_SCHEMA = cv.Schema(
+    {
+        # cheapest first; a framesize that is not a 1/1, 1/2, 1/4 or 1/8 multiple of the model input is decoded at
+        # the closest larger scale and resized, which costs a second pass over the frame
+        cv.Optional(CONF_FRAMESIZES, default=["QCIF"]): cv.ensure_list(
+            cv.one_of(*FRAMESIZES, upper=True)
+        ),
+        cv.Optional(CONF_BEST_QUALITY, default=10): cv.int_range(min=0, max=63),
+        cv.Optional(CONF_WORST_QUALITY, default=40): cv.int_range(min=0, max=63),
+        cv.Optional(CONF_QUALITY_STEP, default=5): cv.int_range(min=1, max=63),
+        cv.Optional(CONF_MARGIN_THRESHOLD, default=64): cv.uint8_t,
+        cv.Optional(CONF_WINDOW, default=20): cv.int_range(min=1),
+    }
+)
+
+PREVIEW_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_FRAMESIZE, default="QQVGA"): cv.one_of(*FRAMESIZES, upper=True),
+        cv.Optional(CONF_PIXEL_THRESHOLD, default=24): cv.uint8_t,
+        cv.Optional(CONF_CHANGED_PERCENT, default=3): cv.int_range(min=1, max=100),
+        # smoothed "empty" decisions before dropping back, keep it above the smoothing window
+        cv.Optional(CONF_EMPTY_FRAMES, default=20): cv.int_range(min=1),
+    }
+)
+
+QUALITY_GATE_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_MAX_DARK_PERCENT, default=80): cv.int_range(min=0, max=100),
+        cv.Optional(CONF_MAX_SATURATED_PERCENT, default=30): cv.int_range(
+            min=0, max=100
+        ),
+        cv.Optional(CONF_MIN_GRADIENT, default=2): cv.uint16_t,
+    }
+)
+
+SHADOW_MODEL_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(CONF_RAW_DATA_ID): cv.declare_id(cg.uint8),
+        # .tflite file of the candidate model, it gets the same decoded frame as the main model
+        cv.Required(CONF_FILE): cv.file_,
+        cv.Optional(CONF_SAMPLE_PERCENT, default=10): cv.int_range(min=1, max=100),
+        cv.Optional(CONF_ARENA_SIZE, default="200KB"): cv.validate_bytes,
+        cv.Optional(CONF_AGREEMENT): sensor.sensor_schema(
+            unit_of_measurement=UNIT_PERCENT,
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_LATENCY): sensor.sensor_schema(
+            unit_of_measurement=UNIT_MILLISECOND,
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_SCORE_DELTA): sensor.sensor_schema(
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+    }
+)
+
+REMOTE_INFERENCE_SCHEMA = cv.Schema(
+    {
+        # receives the JPEG as the POST body, answers with one 0-255 score per class, e.g. "3,240,12"
+        cv.Required(CONF_URL): cv.url,
+        # scores arriving later than this are dropped and the frame runs on the device
+        cv.Optional(
+            CONF_TIMEOUT, default="300ms"
+        ): cv.positive_time_period_milliseconds,
+        # the offloaded share of frames grows while states are published later than this after capture, and
+        # shrinks once they are on time again
+        cv.Optional(
+            CONF_LATENCY_BUDGET, default="1000ms"
+        ): cv.positive_time_period_milliseconds,
+        # at least every n-th frame runs on the device
+        cv.Optional(CONF_PROBE_INTERVAL, default=10): cv.int_range(min=2),
+        cv.Optional(CONF_OFFLOADED_FRAMES): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+    }
+)
+
+_MEMORY_SENSOR_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_BYTES,
+    accuracy_decimals=0,
+    state_class=STATE_CLASS_MEASUREMENT,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+
+# sampled with the other metrics every 30 s; free bytes flat while the largest block shrinks means fragmentation
+MEMORY_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_ARENA_USED): _MEMORY_SENSOR_SCHEMA,
+        cv.Optional(CONF_INTERNAL_FREE): _MEMORY_SENSOR_SCHEMA,
+        cv.Optional(CONF_INTERNAL_LARGEST_BLOCK): _MEMORY_SENSOR_SCHEMA,
+        cv.Optional(CONF_PSRAM_FREE): _MEMORY_SENSOR_SCHEMA,
+        cv.Optional(CONF_PSRAM_LARGEST_BLOCK): _MEMORY_SENSOR_SCHEMA,
+        # stack high-water mark of the task running Invoke()
+        cv.Optional(CONF_STACK_FREE): _MEMORY_SENSOR_SCHEMA,
+    }
+)
+
+
+def _validate_thermal(config):
+    if config[CONF_HOT_THRESHOLD] <= config[CONF_WARM_THRESHOLD]:
+        raise cv.Invalid(f"{CONF_HOT_THRESHOLD} must be above {CONF_WARM_THRESHOLD}")
+    return config
+
+
+# only chips with an on-chip temperature sensor (ESP32-S2/S3/C3 and later) are throttled
+THERMAL_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.Optional(CONF_WARM_THRESHOLD, default=65.0): cv.temperature,
+            cv.Optional(CONF_HOT_THRESHOLD, default=75.0): cv.temperature,
+            # a level is left only this far below its threshold
+            cv.Optional(CONF_HYSTERESIS, default=5.0): cv.positive_float,
+            cv.Optional(
+                CONF_WARM_FRAME_DELAY, default="1s"
+            ): cv.positive_time_period_milliseconds,
+            # also caps the quality_tuner ladder at its cheapest step
+            cv.Optional(
+                CONF_HOT_FRAME_DELAY, default="5s"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_TEMPERATURE): sensor.sensor_schema(
+                unit_of_measurement=UNIT_CELSIUS,
+                accuracy_decimals=1,
+                device_class=DEVICE_CLASS_TEMPERATURE,
+                state_class=STATE_CLASS_MEASUREMENT,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
+            cv.Optional(CONF_THROTTLED_TIME): sensor.sensor_schema(
+                unit_of_measurement=UNIT_SECOND,
+                accuracy_decimals=0,
+                state_class=STATE_CLASS_TOTAL_INCREASING,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
+        }
+    ),
+    _validate_thermal,
+)
+
+
+CAMERA_RECOVERY_SCHEMA = cv.Schema(
+    {
+        # without a frame for this long the camera is re-initialized
+        cv.Optional(CONF_TIMEOUT, default="10s"): cv.positive_time_period_milliseconds,
+        # attempts start 1s apart and back off up to this
+        cv.Optional(
+            CONF_MAX_BACKOFF, default="60s"
+        ): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_TIME_TO_RECOVERY): sensor.sensor_schema(
+            unit_of_measurement=UNIT_MILLISECOND,
+            accuracy_decimals=0,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_RECOVERIES): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+    }
+)
+
+
+HEAD_SCHEMA = text_sensor.text_sensor_schema().extend(
+    {
+        # index of the model output tensor, output 0 is the cat classifier published by this sensor
+        cv.Required(CONF_OUTPUT): cv.int_range(min=1),
+        cv.Required(CONF_CLASSES): cv.All(
+            cv.ensure_list(cv.string_strict), cv.Length(min=2)
+        ),
+    }
+)
+
+
+def _validate_roi(config):
+    if config[CONF_X] + config[CONF_WIDTH] > 100:
+        raise cv.Invalid(f"{CONF_X} + {CONF_WIDTH} must not exceed 100%")
+    if config[CONF_Y] + config[CONF_HEIGHT] > 100:
+        raise cv.Invalid(f"{CONF_Y} + {CONF_HEIGHT} must not exceed 100%")
+    return config
+
+
+# region of the frame, in percent of its width and height
+ROI_SCHEMA = cv.All(
+    text_sensor.text_sensor_schema().extend(
+        {
+            cv.Required(CONF_X): cv.int_range(min=0, max=99),
+            cv.Required(CONF_Y): cv.int_range(min=0, max=99),
+            cv.Required(CONF_WIDTH): cv.int_range(min=1, max=100),
+            cv.Required(CONF_HEIGHT): cv.int_range(min=1, max=100),
+        }
+    ),
+    _validate_roi,
+)
+
+
+MOTION_CROP_SCHEMA = cv.Schema(
+    {
+        # change in mean luma of an 8x8 cell of the scaled frame that counts as motion
+        cv.Optional(CONF_THRESHOLD, default=24): cv.int_range(min=1, max=255),
+        # added around the moving cells on every side, in percent of the box
+        cv.Optional(CONF_MARGIN, default=10): cv.int_range(min=0, max=100),
+        # how long the last box is kept once the cat stops moving
+        cv.Optional(CONF_HOLD, default="30s"): cv.positive_time_period_milliseconds,
+    }
+)
+
 
-CONFIG_SCHEMA = (
+def _validate_conv_kernels(config):
+    if config[CONF_SPARSE_CONV] and config[CONF_COMPRESSED_WEIGHTS]:
+        raise cv.Invalid(
+            f"{CONF_SPARSE_CONV} scans dense weights at setup and can not be combined with {CONF_COMPRESSED_WEIGHTS}"
+        )
+    if CONF_WEIGHT_PREFETCH in config and (
+        config[CONF_SPARSE_CONV] or config[CONF_COMPRESSED_WEIGHTS]
+    ):
+        raise cv.Invalid(
+            f"{CONF_WEIGHT_PREFETCH} stages dense weights and can not be combined with "
+            f"{CONF_SPARSE_CONV} or {CONF_COMPRESSED_WEIGHTS}"
+        )
+    return config
+
+
+def _validate_remote_inference(config):
+    # the server answers with class scores, enrollment states are prototypes the server does not know
+    if CONF_REMOTE_INFERENCE in config and CONF_ENROLLMENT in config:
+        raise cv.Invalid(
+            f"{CONF_REMOTE_INFERENCE} returns class scores and can not be combined with {CONF_ENROLLMENT}"
+        )
+    return config
+
+
+CONFIG_SCHEMA = cv.All(
     text_sensor.text_sensor_schema(LitterRobotPresenceDetectorConstructor)
     .extend(
         {
@@ -25,12 +385,122 @@ CONFIG_SCHEMA = (
             cv.Optional(
                 CONF_USE_EMA
             ): cv.boolean_false,  # Exponential Moving Average vs Simple Moving Average
+            # split int8 Conv2D output rows across both cores; where ESP-NN's SIMD kernel needs its single scratch
+            # buffer (every layer on the ESP32-S3) the worker runs the scratch-free kernel and the split rebalances
+            cv.Optional(CONF_PARALLEL_CONV, default=False): cv.boolean,
+            # skip zero weight blocks of a pruned model, rows still split across cores with parallel_conv. The
+            # break-even in tools/.../sparse_bench.cpp, about half of the 4-channel blocks pruned, is against the
+            # dense scalar kernel; ESP-NN's SIMD conv is several times faster, so layers with more than
+            # sparse_max_density percent of their blocks non-zero keep the ESP-NN (or parallel) conv
+            cv.Optional(CONF_SPARSE_CONV, default=False): cv.boolean,
+            cv.Optional(CONF_SPARSE_MAX_DENSITY, default=15): cv.int_range(
+                min=1, max=100
+            ),
+            # replace the final Softmax op with a copy of the logits; the scores are rebuilt from them with the
+            # logits tensor's own quantization, so argmax and margins (quality_tuner) match the Softmax path
+            cv.Optional(CONF_ARGMAX_ONLY, default=False): cv.boolean,
+            # log per-op ticks every 50 frames, e.g. to compare a depthwise-separable model with the current one
+            cv.Optional(CONF_PROFILE_OPS, default=False): cv.boolean,
+            # log cycle counts of decode, resize, input copy and frame statistics once, measured on the first frame
+            # over the following loop() calls while frames wait
+            cv.Optional(CONF_KERNEL_BENCHMARK, default=False): cv.boolean,
+            # decode the two halves of a frame on both cores, needs a sensor that emits JPEG restart markers; full
+            # resolution decodes for rois and the motion crop stay on one core
+            cv.Optional(CONF_PARALLEL_JPEG, default=False): cv.boolean,
+            # raw register writes applied to the camera sensor at setup (sensor specific)
+            cv.Optional(CONF_SENSOR_REGISTERS, default=[]): cv.ensure_list(
+                SENSOR_REGISTER_SCHEMA
+            ),
+            # lower jpeg quality / framesize while classification margins stay stable
+            cv.Optional(CONF_QUALITY_TUNER): QUALITY_TUNER_SCHEMA,
+            # watch a tiny framesize for changes and only run the model while something is there
+            cv.Optional(CONF_PREVIEW): PREVIEW_SCHEMA,
+            # model_data.h holds a model compressed with TFLM's compression tool (LUT weights)
+            cv.Optional(CONF_COMPRESSED_WEIGHTS, default=False): cv.boolean,
+            # internal SRAM for the largest decompressed weight/bias tensors of one op
+            cv.Optional(
+                CONF_DECOMPRESSION_BUFFER_SIZE, default="32KB"
+            ): cv.validate_bytes,
+            # copy the next Conv2D/FullyConnected layer's weights from flash into internal SRAM while the
+            # current one computes; two buffers of buffer_size, larger layers are read in place
+            cv.Optional(CONF_WEIGHT_PREFETCH): cv.Schema(
+                {cv.Optional(CONF_BUFFER_SIZE, default="16KB"): cv.validate_bytes}
+            ),
+            # extra outputs of a multi-head model, each smoothed and published on its own
+            cv.Optional(CONF_HEADS, default=[]): cv.ensure_list(HEAD_SCHEMA),
+            # nearest-centroid cat names from the embedding output, prototypes captured with the
+            # litter_robot_presence_detector.enroll action and kept in flash
+            cv.Optional(CONF_ENROLLMENT): cv.Schema(
+                {cv.Optional(CONF_EMBEDDING_OUTPUT, default=1): cv.int_range(min=1)}
+            ),
+            # undo the camera mounting before the decoded frame is copied into the model input, clockwise degrees;
+            # 90/270 letterbox the turned frame into a non-square input instead of stretching it
+            cv.Optional(CONF_ROTATION, default=0): cv.one_of(0, 90, 180, 270, int=True),
+            # flip the (rotated) image left to right
+            cv.Optional(CONF_MIRROR, default=False): cv.boolean,
+            # classify parts of the frame on their own, e.g. two boxes side by side; the frame is decoded once at
+            # full resolution and every region costs one extra Invoke()
+            cv.Optional(CONF_ROIS, default=[]): cv.ensure_list(ROI_SCHEMA),
+            # find motion on the scaled frame and feed the model the region that moved, cut from a full resolution
+            # decode; the scaled frame when nothing moved. While a box is held only the full resolution decode runs,
+            # without parallel_jpeg. No effect when the framesize is not larger than the model input
+            cv.Optional(CONF_MOTION_CROP): MOTION_CROP_SCHEMA,
+            # skip inference on dark, overexposed or blurred frames
+            cv.Optional(CONF_QUALITY_GATE): QUALITY_GATE_SCHEMA,
+            # run a second model on a sample of frames and report how it compares, without acting on it
+            cv.Optional(CONF_SHADOW_MODEL): SHADOW_MODEL_SCHEMA,
+            # send frames to a server on the LAN while the device is behind its latency budget
+            cv.Optional(CONF_REMOTE_INFERENCE): REMOTE_INFERENCE_SCHEMA,
+            # space frames out and lower quality while the chip runs hot
+            cv.Optional(CONF_THERMAL): THERMAL_SCHEMA,
+            # re-initialize the camera in place when frames stop arriving
+            cv.Optional(CONF_CAMERA_RECOVERY): CAMERA_RECOVERY_SCHEMA,
+            cv.Optional(CONF_MEMORY): MEMORY_SCHEMA,
+            cv.Optional(CONF_SKIPPED_FRAMES): sensor.sensor_schema(
+                accuracy_decimals=0,
+                state_class=STATE_CLASS_TOTAL_INCREASING,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
         }
     )
-    .extend(cv.COMPONENT_SCHEMA)
+    .extend(cv.COMPONENT_SCHEMA),
+    _validate_conv_kernels,
+    _validate_remote_inference,
+)
+
+
+ENROLLMENT_ACTIONS = (
+    "litter_robot_presence_detector.enroll",
+    "litter_robot_presence_detector.clear_enrollment",
 )
 
 
+def _enrollment_actions(node):
+    if isinstance(node, dict):
+        for key, value in node.items():
+            if key in ENROLLMENT_ACTIONS:
+                yield key, value
+            yield from _enrollment_actions(value)
+    elif isinstance(node, list):
+        for item in node:
+            yield from _enrollment_actions(item)
+
+
+def _final_validate(config):
+    # the action classes only exist with USE_ENROLLMENT, so catch it here instead of at C++ compile time
+    if CONF_ENROLLMENT in config:
+        return config
+    for action, action_config in _enrollment_actions(fv.full_config.get()):
+        if action_config[CONF_ID].id == config[CONF_ID].id:
+            raise cv.Invalid(
+                f"{action} needs {CONF_ENROLLMENT} configured on '{config[CONF_ID].id}'"
+            )
+    return config
+
+
+FINAL_VALIDATE_SCHEMA = _final_validate
+
+
 async def to_code(config):
     var = await text_sensor.new_text_sensor(config)
     # cg.new_Pvariable(config[CONF_ID])
@@ -50,6 +520,214 @@ async def to_code(config):
     if config[CONF_USE_EMA]:
         cg.add_define("USE_EMA")
 
+    if config[CONF_PARALLEL_CONV]:
+        cg.add_define("USE_PARALLEL_CONV")
+
+    if config[CONF_SPARSE_CONV]:
+        cg.add_define("USE_SPARSE_CONV")
+        cg.add(var.set_sparse_max_density(config[CONF_SPARSE_MAX_DENSITY]))
+
+    if config[CONF_ARGMAX_ONLY]:
+        cg.add_define("USE_LOGITS_OUTPUT")
+
+    if config[CONF_PROFILE_OPS]:
+        cg.add_define("USE_OP_PROFILER")
+
+    if config[CONF_KERNEL_BENCHMARK]:
+        cg.add_define("USE_KERNEL_BENCHMARK")
+
+    if config[CONF_PARALLEL_JPEG]:
+        cg.add_define("USE_PARALLEL_JPEG")
+
+    for reg in config[CONF_SENSOR_REGISTERS]:
+        cg.add(
+            var.add_sensor_register(reg[CONF_ADDRESS], reg[CONF_MASK], reg[CONF_VALUE])
+        )
+
+    if CONF_QUALITY_TUNER in config:
+        cg.add_define("USE_QUALITY_TUNER")
+        tuner_config = config[CONF_QUALITY_TUNER]
+        tuner = var.get_quality_tuner()
+        for framesize in tuner_config[CONF_FRAMESIZES]:
+            cg.add(tuner.add_framesize(cg.RawExpression(FRAMESIZES[framesize])))
+        cg.add(
+            tuner.set_quality_range(
+                tuner_config[CONF_BEST_QUALITY],
+                tuner_config[CONF_WORST_QUALITY],
+                tuner_config[CONF_QUALITY_STEP],
+            )
+        )
+        cg.add(tuner.set_margin_threshold(tuner_config[CONF_MARGIN_THRESHOLD]))
+        cg.add(tuner.set_window(tuner_config[CONF_WINDOW]))
+
+    if CONF_PREVIEW in config:
+        cg.add_define("USE_PREVIEW")
+        preview_config = config[CONF_PREVIEW]
+        cg.add(
+            var.set_preview_framesize(
+                cg.RawExpression(FRAMESIZES[preview_config[CONF_FRAMESIZE]])
+            )
+        )
+        gate = var.get_preview_gate()
+        cg.add(gate.set_pixel_threshold(preview_config[CONF_PIXEL_THRESHOLD]))
+        cg.add(gate.set_changed_percent(preview_config[CONF_CHANGED_PERCENT]))
+        cg.add(gate.set_empty_frames(preview_config[CONF_EMPTY_FRAMES]))
+
+    if config[CONF_COMPRESSED_WEIGHTS]:
+        cg.add_build_flag("-DUSE_TFLM_COMPRESSION")
+        cg.add(
+            var.set_decompression_buffer_size(config[CONF_DECOMPRESSION_BUFFER_SIZE])
+        )
+
+    if CONF_WEIGHT_PREFETCH in config:
+        cg.add_define("USE_WEIGHT_PREFETCH")
+        cg.add(
+            var.set_prefetch_buffer_size(
+                config[CONF_WEIGHT_PREFETCH][CONF_BUFFER_SIZE]
+            )
+        )
+
+    if CONF_ENROLLMENT in config:
+        cg.add_define("USE_ENROLLMENT")
+        # SIMD dot product for the prototype search
+        esp32.add_idf_component(
+            name="esp-dsp",
+            repo="https://github.com/espressif/esp-dsp",
+        )
+        cg.add(
+            var.set_embedding_output(
+                config[CONF_ENROLLMENT][CONF_EMBEDDING_OUTPUT]
+            )
+        )
+
+    for head_config in config[CONF_HEADS]:
+        head = await text_sensor.new_text_sensor(head_config)
+        cg.add(
+            var.add_head(head, head_config[CONF_OUTPUT], head_config[CONF_CLASSES])
+        )
+
+    if CONF_MOTION_CROP in config:
+        cg.add_define("USE_MOTION_CROP")
+        motion_config = config[CONF_MOTION_CROP]
+        motion_crop = var.get_motion_crop()
+        cg.add(motion_crop.set_threshold(motion_config[CONF_THRESHOLD]))
+        cg.add(motion_crop.set_margin(motion_config[CONF_MARGIN]))
+        cg.add(motion_crop.set_hold(motion_config[CONF_HOLD]))
+
+    if config[CONF_ROTATION] != 0 or config[CONF_MIRROR]:
+        cg.add_define("USE_ORIENTATION")
+        orientation = var.get_orientation()
+        cg.add(orientation.set_rotation(config[CONF_ROTATION]))
+        cg.add(orientation.set_mirror(config[CONF_MIRROR]))
+
+    if config[CONF_ROIS] or CONF_MOTION_CROP in config:
+        cg.add_define("USE_FULL_FRAME")
+    if config[CONF_ROIS]:
+        cg.add_define("USE_ROIS")
+    for roi_config in config[CONF_ROIS]:
+        roi = await text_sensor.new_text_sensor(roi_config)
+        cg.add(
+            var.add_roi(
+                roi,
+                roi_config[CONF_X],
+                roi_config[CONF_Y],
+                roi_config[CONF_WIDTH],
+                roi_config[CONF_HEIGHT],
+            )
+        )
+
+    if CONF_QUALITY_GATE in config:
+        cg.add_define("USE_QUALITY_GATE")
+        gate_config = config[CONF_QUALITY_GATE]
+        quality_gate = var.get_quality_gate()
+        cg.add(quality_gate.set_max_dark_percent(gate_config[CONF_MAX_DARK_PERCENT]))
+        cg.add(
+            quality_gate.set_max_saturated_percent(
+                gate_config[CONF_MAX_SATURATED_PERCENT]
+            )
+        )
+        cg.add(quality_gate.set_min_gradient(gate_config[CONF_MIN_GRADIENT]))
+
+    if CONF_SKIPPED_FRAMES in config:
+        sens = await sensor.new_sensor(config[CONF_SKIPPED_FRAMES])
+        cg.add(var.set_skipped_frames_sensor(sens))
+
+    if CONF_SHADOW_MODEL in config:
+        cg.add_define("USE_SHADOW_MODEL")
+        shadow_config = config[CONF_SHADOW_MODEL]
+        with open(CORE.relative_config_path(shadow_config[CONF_FILE]), "rb") as f:
+            model_data = f.read()
+        prog_arr = cg.progmem_array(
+            shadow_config[CONF_RAW_DATA_ID], [HexInt(x) for x in model_data]
+        )
+        shadow = var.get_shadow_model()
+        cg.add(shadow.set_model(prog_arr, len(model_data)))
+        cg.add(shadow.set_sample_percent(shadow_config[CONF_SAMPLE_PERCENT]))
+        cg.add(shadow.set_arena_size(shadow_config[CONF_ARENA_SIZE]))
+        if CONF_AGREEMENT in shadow_config:
+            sens = await sensor.new_sensor(shadow_config[CONF_AGREEMENT])
+            cg.add(var.set_shadow_agreement_sensor(sens))
+        if CONF_LATENCY in shadow_config:
+            sens = await sensor.new_sensor(shadow_config[CONF_LATENCY])
+            cg.add(var.set_shadow_latency_sensor(sens))
+        if CONF_SCORE_DELTA in shadow_config:
+            sens = await sensor.new_sensor(shadow_config[CONF_SCORE_DELTA])
+            cg.add(var.set_shadow_score_delta_sensor(sens))
+
+    if CONF_REMOTE_INFERENCE in config:
+        cg.add_define("USE_REMOTE_INFERENCE")
+        remote_config = config[CONF_REMOTE_INFERENCE]
+        remote = var.get_remote_inference()
+        cg.add(remote.set_url(remote_config[CONF_URL]))
+        cg.add(remote.set_timeout(remote_config[CONF_TIMEOUT]))
+        cg.add(remote.set_latency_budget(remote_config[CONF_LATENCY_BUDGET]))
+        cg.add(remote.set_probe_interval(remote_config[CONF_PROBE_INTERVAL]))
+        if CONF_OFFLOADED_FRAMES in remote_config:
+            sens = await sensor.new_sensor(remote_config[CONF_OFFLOADED_FRAMES])
+            cg.add(var.set_offloaded_frames_sensor(sens))
+
+    if CONF_THERMAL in config:
+        cg.add_define("USE_THERMAL_GOVERNOR")
+        thermal_config = config[CONF_THERMAL]
+        governor = var.get_thermal_governor()
+        cg.add(governor.set_warm_threshold(thermal_config[CONF_WARM_THRESHOLD]))
+        cg.add(governor.set_hot_threshold(thermal_config[CONF_HOT_THRESHOLD]))
+        cg.add(governor.set_hysteresis(thermal_config[CONF_HYSTERESIS]))
+        cg.add(governor.set_warm_frame_delay(thermal_config[CONF_WARM_FRAME_DELAY]))
+        cg.add(governor.set_hot_frame_delay(thermal_config[CONF_HOT_FRAME_DELAY]))
+        if CONF_TEMPERATURE in thermal_config:
+            sens = await sensor.new_sensor(thermal_config[CONF_TEMPERATURE])
+            cg.add(var.set_chip_temperature_sensor(sens))
+        if CONF_THROTTLED_TIME in thermal_config:
+            sens = await sensor.new_sensor(thermal_config[CONF_THROTTLED_TIME])
+            cg.add(var.set_throttled_time_sensor(sens))
+
+    if CONF_CAMERA_RECOVERY in config:
+        recovery_config = config[CONF_CAMERA_RECOVERY]
+        recovery = var.get_camera_recovery()
+        cg.add(recovery.set_timeout(recovery_config[CONF_TIMEOUT]))
+        cg.add(recovery.set_max_backoff(recovery_config[CONF_MAX_BACKOFF]))
+        if CONF_TIME_TO_RECOVERY in recovery_config:
+            sens = await sensor.new_sensor(recovery_config[CONF_TIME_TO_RECOVERY])
+            cg.add(var.set_recovery_time_sensor(sens))
+        if CONF_RECOVERIES in recovery_config:
+            sens = await sensor.new_sensor(recovery_config[CONF_RECOVERIES])
+            cg.add(var.set_recoveries_sensor(sens))
+
+    if CONF_MEMORY in config:
+        memory_config = config[CONF_MEMORY]
+        for key, setter in (
+            (CONF_ARENA_USED, var.set_arena_used_sensor),
+            (CONF_INTERNAL_FREE, var.set_internal_free_sensor),
+            (CONF_INTERNAL_LARGEST_BLOCK, var.set_internal_largest_block_sensor),
+            (CONF_PSRAM_FREE, var.set_psram_free_sensor),
+            (CONF_PSRAM_LARGEST_BLOCK, var.set_psram_largest_block_sensor),
+            (CONF_STACK_FREE, var.set_stack_free_sensor),
+        ):
+            if key in memory_config:
+                sens = await sensor.new_sensor(memory_config[key])
+                cg.add(setter(sens))
+
     # inferrence could take a long time, set Watchdog timeout to 10s
     esp32.add_idf_sdkconfig_option("CONFIG_ESP_TASK_WDT_TIMEOUT_S", 20)
 
@@ -57,3 +735,41 @@ async def to_code(config):
     cg.add_build_flag("-DTF_LITE_DISABLE_X86_NEON")
     # cg.add_build_flag("-DESP_NN")
     cg.add_build_flag("-DNN_OPTIMIZATIONS")
+
+
+@automation.register_action(
+    "litter_robot_presence_detector.enroll",
+    EnrollAction,
+    cv.Schema(
+        {
+            cv.GenerateID(): cv.use_id(LitterRobotPresenceDetectorConstructor),
+            cv.Required(CONF_NAME): cv.templatable(cv.string),
+            cv.Optional(CONF_FRAMES, default=5): cv.templatable(
+                cv.int_range(min=1, max=50)
+            ),
+        }
+    ),
+)
+async def enroll_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    name = await cg.templatable(config[CONF_NAME], args, cg.std_string)
+    cg.add(var.set_name(name))
+    frames = await cg.templatable(config[CONF_FRAMES], args, cg.uint32)
+    cg.add(var.set_frames(frames))
+    return var
+
+
+@automation.register_action(
+    "litter_robot_presence_detector.clear_enrollment",
+    ClearEnrollmentAction,
+    cv.Schema(
+        {
+            cv.GenerateID(): cv.use_id(LitterRobotPresenceDetectorConstructor),
+        }
+    ),
+)
+async def clear_enrollment_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
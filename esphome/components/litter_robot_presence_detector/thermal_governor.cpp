@@ -0,0 +1,95 @@
+#ifdef USE_ESP32
+#include "thermal_governor.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+static const char *const TAG = "litter_robot_presence_detector.thermal";
+static const char *const LEVEL_NAMES[] = {"normal", "warm", "hot"};
+
+bool ThermalGovernor::setup() {
+#if SOC_TEMP_SENSOR_SUPPORTED
+  // the range with the best accuracy that still covers an enclosed board
+  temperature_sensor_config_t config = TEMPERATURE_SENSOR_CONFIG_DEFAULT(20, 100);
+  if (temperature_sensor_install(&config, &this->sensor_) != ESP_OK) {
+    ESP_LOGE(TAG, "Could not install the temperature sensor.");
+    this->sensor_ = nullptr;
+    return false;
+  }
+  if (temperature_sensor_enable(this->sensor_) != ESP_OK) {
+    ESP_LOGE(TAG, "Could not enable the temperature sensor.");
+    return false;
+  }
+  return true;
+#else
+  ESP_LOGW(TAG, "this chip has no temperature sensor, inference is never throttled");
+  return false;
+#endif
+}
+
+ThermalLevel ThermalGovernor::level_for_(float temperature) const {
+  // rising needs the threshold, falling needs the threshold minus the hysteresis
+  ThermalLevel level = this->level_;
+  if (temperature >= this->hot_threshold_) {
+    return ThermalLevel::HOT;
+  }
+  if (level == ThermalLevel::HOT && temperature >= this->hot_threshold_ - this->hysteresis_) {
+    return ThermalLevel::HOT;
+  }
+  if (temperature >= this->warm_threshold_) {
+    return ThermalLevel::WARM;
+  }
+  if (level != ThermalLevel::NORMAL && temperature >= this->warm_threshold_ - this->hysteresis_) {
+    return ThermalLevel::WARM;
+  }
+  return ThermalLevel::NORMAL;
+}
+
+bool ThermalGovernor::update() {
+#if SOC_TEMP_SENSOR_SUPPORTED
+  if (this->sensor_ == nullptr || temperature_sensor_get_celsius(this->sensor_, &this->temperature_) != ESP_OK) {
+    return false;
+  }
+#else
+  return false;
+#endif
+
+  ThermalLevel level = this->level_for_(this->temperature_);
+  if (level == this->level_) {
+    return false;
+  }
+
+  uint32_t now = millis();
+  if (this->level_ == ThermalLevel::NORMAL) {
+    this->throttled_since_ = now;
+  } else if (level == ThermalLevel::NORMAL) {
+    this->throttled_total_ms_ += now - this->throttled_since_;
+  }
+  ESP_LOGI(TAG, "%.1f°C, %s -> %s", this->temperature_, LEVEL_NAMES[(int) this->level_], LEVEL_NAMES[(int) level]);
+  this->level_ = level;
+  return true;
+}
+
+uint32_t ThermalGovernor::frame_delay() const {
+  switch (this->level_) {
+    case ThermalLevel::WARM:
+      return this->warm_frame_delay_;
+    case ThermalLevel::HOT:
+      return this->hot_frame_delay_;
+    default:
+      return 0;
+  }
+}
+
+uint32_t ThermalGovernor::throttled_ms(uint32_t now) const {
+  if (this->level_ == ThermalLevel::NORMAL) {
+    return this->throttled_total_ms_;
+  }
+  return this->throttled_total_ms_ + (now - this->throttled_since_);
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+
+#ifdef USE_ESP32
+
+#include <soc/soc_caps.h>
+#if SOC_TEMP_SENSOR_SUPPORTED
+#include <driver/temperature_sensor.h>
+#endif
+
+#include <cstdint>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+enum class ThermalLevel : uint8_t { NORMAL, WARM, HOT };
+
+// Reads the on-chip temperature sensor and slows inference down when the board runs hot: WARM spaces frames out,
+// HOT spaces them out further and caps the quality ladder at its cheapest step. A level is only left once the
+// temperature has dropped `hysteresis` degrees below its threshold, so the governor does not oscillate around it.
+class ThermalGovernor {
+ public:
+  void set_warm_threshold(float warm_threshold) { this->warm_threshold_ = warm_threshold; }
+  void set_hot_threshold(float hot_threshold) { this->hot_threshold_ = hot_threshold; }
+  void set_hysteresis(float hysteresis) { this->hysteresis_ = hysteresis; }
+  void set_warm_frame_delay(uint32_t warm_frame_delay) { this->warm_frame_delay_ = warm_frame_delay; }
+  void set_hot_frame_delay(uint32_t hot_frame_delay) { this->hot_frame_delay_ = hot_frame_delay; }
+
+  bool setup();
+  // Samples the sensor. Returns true when the level changed.
+  bool update();
+
+  ThermalLevel level() const { return this->level_; }
+  float temperature() const { return this->temperature_; }
+  // minimum time between the start of two frames at the current level
+  uint32_t frame_delay() const;
+  // time spent above NORMAL, including the current stretch
+  uint32_t throttled_ms(uint32_t now) const;
+
+ protected:
+  ThermalLevel level_for_(float temperature) const;
+
+  float warm_threshold_{65.0f};
+  float hot_threshold_{75.0f};
+  float hysteresis_{5.0f};
+  uint32_t warm_frame_delay_{1000};
+  uint32_t hot_frame_delay_{5000};
+
+#if SOC_TEMP_SENSOR_SUPPORTED
+  temperature_sensor_handle_t sensor_{nullptr};
+#endif
+  ThermalLevel level_{ThermalLevel::NORMAL};
+  float temperature_{0.0f};
+  uint32_t throttled_since_{0};
+  uint32_t throttled_total_ms_{0};
+};
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+
+#endif
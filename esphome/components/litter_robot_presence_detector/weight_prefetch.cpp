@@ -0,0 +1,198 @@
+#ifdef USE_ESP32
+#include "weight_prefetch.h"
+#include "esphome/core/log.h"
+
+#include "tensorflow/lite/micro/kernels/kernel_util.h"
+#include "tensorflow/lite/micro/micro_context.h"
+
+#include <esp_heap_caps.h>
+#include <cstring>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+static const char *const TAG = "litter_robot_presence_detector.prefetch";
+// The task only waits and calls memcpy, most of the stack is interrupt frames. Check the prefetch stack free in
+// dump_config on the target before shrinking this.
+static const uint32_t PREFETCH_STACK_SIZE = 2048;
+// weights are input 1 of both Conv2D and FullyConnected
+static const int WEIGHTS_INPUT = 1;
+
+WeightPrefetcher *global_weight_prefetcher = nullptr;
+
+bool WeightPrefetcher::setup(size_t buffer_size) {
+  for (auto &buffer : this->buffers_) {
+    buffer = static_cast<uint8_t *>(heap_caps_malloc(buffer_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    if (buffer == nullptr) {
+      ESP_LOGE(TAG, "Could not allocate %u bytes of weight staging memory.", (unsigned) buffer_size);
+      return false;
+    }
+  }
+  this->buffer_size_ = buffer_size;
+
+  this->start_ = xSemaphoreCreateBinary();
+  this->done_ = xSemaphoreCreateBinary();
+  if (this->start_ == nullptr || this->done_ == nullptr) {
+    ESP_LOGE(TAG, "failed to create prefetch semaphores");
+    return false;
+  }
+  // The copy shares the other core with the dual core worker, which is created at the caller's priority. One level
+  // below it the worker's kernel bands preempt the copy instead of time slicing with it, and the copy still fills
+  // the core while the worker waits. On a single core chip it runs whenever Invoke() blocks.
+  this->core_ = portNUM_PROCESSORS > 1 ? (xPortGetCoreID() == 0 ? 1 : 0) : 0;
+  const UBaseType_t caller_priority = uxTaskPriorityGet(nullptr);
+  this->priority_ = caller_priority > tskIDLE_PRIORITY ? caller_priority - 1 : tskIDLE_PRIORITY;
+  if (xTaskCreatePinnedToCore(WeightPrefetcher::prefetch_task_, "lr_prefetch", PREFETCH_STACK_SIZE, this,
+                              this->priority_, &this->task_, this->core_) != pdPASS) {
+    ESP_LOGE(TAG, "failed to create prefetch task");
+    this->task_ = nullptr;
+    return false;
+  }
+  ESP_LOGD(TAG, "prefetch task pinned to core %d at priority %u, below the worker's %u", (int) this->core_,
+           (unsigned) this->priority_, (unsigned) caller_priority);
+  return true;
+}
+
+uint32_t WeightPrefetcher::stack_size() const { return PREFETCH_STACK_SIZE; }
+
+int WeightPrefetcher::add_layer(const void *weights, size_t size) {
+  int buffer = -1;
+  if (size <= this->buffer_size_) {
+    buffer = this->num_staged_ % 2;
+    this->num_staged_++;
+  }
+  this->layers_.push_back({weights, size, buffer});
+  return this->layers_.size() - 1;
+}
+
+void WeightPrefetcher::prefetch_task_(void *param) {
+  WeightPrefetcher *prefetcher = static_cast<WeightPrefetcher *>(param);
+  while (true) {
+    xSemaphoreTake(prefetcher->start_, portMAX_DELAY);
+    const Layer &layer = prefetcher->layers_[prefetcher->in_flight_];
+    memcpy(prefetcher->buffers_[layer.buffer], layer.weights, layer.size);
+    xSemaphoreGive(prefetcher->done_);
+  }
+}
+
+int WeightPrefetcher::next_staged_(int layer) const {
+  const int count = this->layers_.size();
+  for (int step = 1; step < count; step++) {
+    int next = (layer + step) % count;
+    if (this->layers_[next].buffer >= 0) {
+      return next;
+    }
+  }
+  return -1;
+}
+
+void WeightPrefetcher::wait_() {
+  if (this->in_flight_ < 0) {
+    return;
+  }
+  xSemaphoreTake(this->done_, portMAX_DELAY);
+  this->staged_[this->layers_[this->in_flight_].buffer] = this->in_flight_;
+  this->in_flight_ = -1;
+}
+
+const void *WeightPrefetcher::acquire(int layer) {
+  if (this->task_ == nullptr || layer < 0 || layer >= (int) this->layers_.size() ||
+      this->layers_[layer].buffer < 0) {
+    return nullptr;
+  }
+  const Layer &current = this->layers_[layer];
+
+  // whatever is in flight is either this layer or was queued by another interpreter sharing the kernels
+  this->wait_();
+  if (this->staged_[current.buffer] == layer) {
+    this->hits_++;
+  } else {
+    memcpy(this->buffers_[current.buffer], current.weights, current.size);
+    this->staged_[current.buffer] = layer;
+    this->misses_++;
+  }
+
+  // the last layer of a frame prefetches the first one of the next frame, unless both use the same buffer
+  int next = this->next_staged_(layer);
+  if (next >= 0 && this->layers_[next].buffer != current.buffer && this->staged_[this->layers_[next].buffer] != next) {
+    this->in_flight_ = next;
+    xSemaphoreGive(this->start_);
+  }
+  return this->buffers_[current.buffer];
+}
+
+// Base kernel data plus the layer id, the base kernel gets its own user_data back around every call.
+struct PrefetchOpData {
+  void *base;
+  int layer;
+};
+
+template<int SLOT> struct PrefetchedOp {
+  static TFLMRegistration base;
+
+  static void *init(TfLiteContext *context, const char *buffer, size_t length) {
+    PrefetchOpData *data =
+        static_cast<PrefetchOpData *>(context->AllocatePersistentBuffer(context, sizeof(PrefetchOpData)));
+    if (data == nullptr) {
+      return nullptr;
+    }
+    data->base = base.init != nullptr ? base.init(context, buffer, length) : nullptr;
+    data->layer = -1;
+    return data;
+  }
+
+  static TfLiteStatus prepare(TfLiteContext *context, TfLiteNode *node) {
+    PrefetchOpData *data = static_cast<PrefetchOpData *>(node->user_data);
+    node->user_data = data->base;
+    TfLiteStatus status = base.prepare(context, node);
+    node->user_data = data;
+    if (status != kTfLiteOk || global_weight_prefetcher == nullptr) {
+      return status;
+    }
+
+    tflite::MicroContext *micro_context = tflite::GetMicroContext(context);
+    TfLiteTensor *weights = micro_context->AllocateTempInputTensor(node, WEIGHTS_INPUT);
+    TF_LITE_ENSURE(context, weights != nullptr);
+    if (weights->allocation_type == kTfLiteMmapRo) {
+      data->layer = global_weight_prefetcher->add_layer(weights->data.data, weights->bytes);
+    }
+    micro_context->DeallocateTempTfLiteTensor(weights);
+    return kTfLiteOk;
+  }
+
+  static TfLiteStatus invoke(TfLiteContext *context, TfLiteNode *node) {
+    PrefetchOpData *data = static_cast<PrefetchOpData *>(node->user_data);
+    TfLiteEvalTensor *weights = context->GetEvalTensor(context, node->inputs->data[WEIGHTS_INPUT]);
+    void *original = weights->data.data;
+    const void *staged = global_weight_prefetcher != nullptr ? global_weight_prefetcher->acquire(data->layer) : nullptr;
+    if (staged != nullptr) {
+      weights->data.data = const_cast<void *>(staged);
+    }
+    node->user_data = data->base;
+    TfLiteStatus status = base.invoke(context, node);
+    node->user_data = data;
+    weights->data.data = original;
+    return status;
+  }
+
+  static TFLMRegistration wrap(const TFLMRegistration &registration) {
+    base = registration;
+    TFLMRegistration wrapped = registration;
+    wrapped.init = init;
+    wrapped.prepare = prepare;
+    wrapped.invoke = invoke;
+    return wrapped;
+  }
+};
+
+template<int SLOT> TFLMRegistration PrefetchedOp<SLOT>::base = {};
+
+TFLMRegistration Register_PREFETCHED_CONV_2D(const TFLMRegistration &base) { return PrefetchedOp<0>::wrap(base); }
+
+TFLMRegistration Register_PREFETCHED_FULLY_CONNECTED(const TFLMRegistration &base) {
+  return PrefetchedOp<1>::wrap(base);
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+#endif
@@ -0,0 +1,75 @@
+#pragma once
+
+#ifdef USE_ESP32
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <tensorflow/lite/micro/micro_common.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+// Streams layer weights from flash into two internal SRAM staging buffers. While layer n computes from one buffer,
+// a task on the other core, one priority level below the dual core worker, copies the next staged layer into the
+// other one. Layers register in Prepare order, which is the execution order; weights larger than a buffer stay where
+// they are.
+class WeightPrefetcher {
+ public:
+  bool setup(size_t buffer_size);
+  // returns the layer id to pass to acquire()
+  int add_layer(const void *weights, size_t size);
+  // Returns the staged copy of the layer's weights, or nullptr to read them in place, and starts prefetching the
+  // next staged layer.
+  const void *acquire(int layer);
+
+  size_t buffer_size() const { return this->buffer_size_; }
+  size_t num_layers() const { return this->layers_.size(); }
+  size_t num_staged() const { return this->num_staged_; }
+  uint32_t prefetch_hits() const { return this->hits_; }
+  uint32_t prefetch_misses() const { return this->misses_; }
+  TaskHandle_t task() const { return this->task_; }
+  BaseType_t core() const { return this->core_; }
+  uint32_t stack_size() const;
+
+ protected:
+  struct Layer {
+    const void *weights;
+    size_t size;
+    int buffer;  // -1 when the weights do not fit
+  };
+
+  static void prefetch_task_(void *param);
+  int next_staged_(int layer) const;
+  void wait_();
+
+  size_t buffer_size_{0};
+  uint8_t *buffers_[2]{nullptr, nullptr};
+  std::vector<Layer> layers_;
+  size_t num_staged_{0};
+
+  TaskHandle_t task_{nullptr};
+  BaseType_t core_{0};
+  UBaseType_t priority_{0};
+  SemaphoreHandle_t start_{nullptr};
+  SemaphoreHandle_t done_{nullptr};
+  int in_flight_{-1};
+  int staged_[2]{-1, -1};  // layer held by each buffer
+  uint32_t hits_{0};
+  uint32_t misses_{0};
+};
+
+extern WeightPrefetcher *global_weight_prefetcher;
+
+// Wrap a Conv2D or FullyConnected registration so its weights are read from the staging buffers.
+TFLMRegistration Register_PREFETCHED_CONV_2D(const TFLMRegistration &base);
+TFLMRegistration Register_PREFETCHED_FULLY_CONNECTED(const TFLMRegistration &base);
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
+
+#endif
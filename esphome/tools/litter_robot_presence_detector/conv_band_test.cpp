@@ -0,0 +1,143 @@
+// Checks that parallel_conv's row bands are bit-exact with one full-tensor Conv2D: every split point of every
+// layer geometry below runs as two band calls on their input slices and is compared with the full-size call.
+// The kernel is the scalar reference Conv2D from reference_ops.h, which ESP-NN matches bit for bit; what is under
+// test is the slicing and padding math in conv_band.h that both kernels are fed with.
+//
+// Build and run on the host:
+//   SRC=../../components/litter_robot_presence_detector
+//   g++ -std=c++17 -O2 -I$SRC conv_band_test.cpp -lgtest -lgtest_main -lpthread -o conv_band_test && ./conv_band_test
+
+#include "conv_band.h"
+#include "reference_ops.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+namespace {
+
+struct Geometry {
+  int input_height;
+  int input_width;
+  int input_depth;
+  int filter_size;
+  int stride;
+  int dilation;
+  bool same_padding;
+  int output_depth;
+};
+
+struct Layer {
+  Geometry geometry;
+  int output_height;
+  int output_width;
+  int pad_top;
+  int pad_left;
+  std::vector<int8_t> input;
+  std::vector<int8_t> filter;
+  std::vector<int32_t> bias;
+  std::vector<int32_t> multiplier;
+  std::vector<int32_t> shift;
+};
+
+// Conv2D over rows [0, output_height) of an input of input_height rows
+void conv(const Layer &layer, const int8_t *input, int input_height, int pad_top, int8_t *output,
+          int output_height) {
+  const Geometry &g = layer.geometry;
+  const ConvGeometry geometry = {input_height,   g.input_width, g.input_depth,      g.filter_size,
+                                 g.filter_size,  g.stride,      g.dilation,         pad_top,
+                                 layer.pad_left, output_height, layer.output_width, g.output_depth};
+  reference_conv_s8(geometry, input, layer.filter.data(), layer.bias.data(), layer.multiplier.data(),
+                    layer.shift.data(), 128, -5, output);
+}
+
+Layer make_layer(const Geometry &g, uint32_t seed) {
+  Layer layer;
+  layer.geometry = g;
+  const int extent = (g.filter_size - 1) * g.dilation + 1;
+  if (g.same_padding) {
+    // TFLM SAME padding: the odd pixel goes to the bottom and right
+    layer.output_height = (g.input_height + g.stride - 1) / g.stride;
+    layer.output_width = (g.input_width + g.stride - 1) / g.stride;
+    layer.pad_top = std::max(0, ((layer.output_height - 1) * g.stride + extent - g.input_height) / 2);
+    layer.pad_left = std::max(0, ((layer.output_width - 1) * g.stride + extent - g.input_width) / 2);
+  } else {
+    layer.output_height = (g.input_height - extent) / g.stride + 1;
+    layer.output_width = (g.input_width - extent) / g.stride + 1;
+    layer.pad_top = 0;
+    layer.pad_left = 0;
+  }
+
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> byte(-128, 127);
+  layer.input.resize(g.input_height * g.input_width * g.input_depth);
+  for (auto &v : layer.input) {
+    v = byte(rng);
+  }
+  layer.filter.resize(g.output_depth * g.filter_size * g.filter_size * g.input_depth);
+  for (auto &v : layer.filter) {
+    v = byte(rng);
+  }
+  std::uniform_int_distribution<int32_t> bias(-20000, 20000);
+  std::uniform_int_distribution<int32_t> multiplier(1 << 30, INT32_MAX);
+  std::uniform_int_distribution<int> shift(-12, -6);
+  for (int c = 0; c < g.output_depth; c++) {
+    layer.bias.push_back(bias(rng));
+    layer.multiplier.push_back(multiplier(rng));
+    layer.shift.push_back(shift(rng));
+  }
+  return layer;
+}
+
+class ConvBandTest : public ::testing::TestWithParam<Geometry> {};
+
+TEST_P(ConvBandTest, BandsMatchFullTensor) {
+  const Geometry &g = GetParam();
+  const Layer layer = make_layer(g, g.input_height * 131 + g.filter_size * 17 + g.stride);
+  ASSERT_GE(layer.output_height, 2);
+  const size_t row_bytes = layer.output_width * g.output_depth;
+  const size_t input_row_bytes = g.input_width * g.input_depth;
+
+  std::vector<int8_t> full(layer.output_height * row_bytes);
+  conv(layer, layer.input.data(), g.input_height, layer.pad_top, full.data(), layer.output_height);
+
+  // parallel_conv splits at output_height / 2, every split point covers that and the uneven bands around it
+  for (int split = 1; split < layer.output_height; split++) {
+    std::vector<int8_t> banded(full.size(), 0x55);
+    const int bands[2][2] = {{0, split}, {split, layer.output_height}};
+    for (const auto &band : bands) {
+      ConvBandRows rows = plan_conv_band(band[0], band[1], g.input_height, g.filter_size, g.stride, g.dilation,
+                                         layer.pad_top);
+      ASSERT_GE(rows.input_begin, 0);
+      ASSERT_LE(rows.input_end, g.input_height);
+      ASSERT_GE(rows.pad_top, 0);
+      conv(layer, layer.input.data() + rows.input_begin * input_row_bytes, rows.input_end - rows.input_begin,
+           rows.pad_top, banded.data() + band[0] * row_bytes, band[1] - band[0]);
+    }
+    ASSERT_EQ(banded, full) << "split at output row " << split << " of " << layer.output_height;
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Geometries, ConvBandTest,
+                         ::testing::Values(
+                             // both Conv2D layers of the model in model_data.h (176x155 input)
+                             Geometry{155, 176, 3, 5, 3, 1, true, 25}, Geometry{26, 30, 25, 5, 2, 1, true, 30},
+                             Geometry{72, 88, 8, 3, 1, 1, true, 16}, Geometry{72, 88, 8, 1, 1, 1, false, 16},
+                             // odd heights with SAME padding put the extra padding row at the bottom
+                             Geometry{7, 9, 4, 3, 1, 1, true, 4}, Geometry{9, 7, 3, 3, 2, 1, true, 5},
+                             Geometry{15, 11, 2, 5, 2, 1, true, 3}, Geometry{13, 13, 3, 5, 3, 1, true, 4},
+                             Geometry{11, 8, 2, 4, 2, 1, true, 3},
+                             // VALID padding and strides that skip input rows between bands
+                             Geometry{9, 9, 3, 3, 1, 1, false, 4}, Geometry{17, 10, 2, 3, 2, 1, false, 3},
+                             Geometry{23, 12, 2, 2, 3, 1, false, 3}, Geometry{12, 12, 2, 1, 2, 1, false, 3},
+                             // dilation, run on the reference kernel but banded the same way
+                             Geometry{15, 10, 2, 3, 1, 2, true, 3}, Geometry{16, 10, 2, 3, 2, 2, false, 3}));
+
+}  // namespace
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
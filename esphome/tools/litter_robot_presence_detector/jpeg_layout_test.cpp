@@ -0,0 +1,231 @@
+// Checks the header parsing and restart-marker split that parallel_jpeg feeds to two tjpgd decoders, on synthetic
+// streams: real marker segments with stand-in entropy-coded data (including stuffed 0xFF 0x00 bytes), so what is
+// under test is where the stream is cut, the patched frame heights and the renumbered RSTn markers, not decoding.
+//
+// Build and run on the host:
+//   SRC=../../components/litter_robot_presence_detector
+//   g++ -std=c++17 -O2 -I$SRC jpeg_layout_test.cpp -lgtest -lgtest_main -lpthread -o jpeg_layout_test
+//   ./jpeg_layout_test
+
+#include "jpeg_layout.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+namespace {
+
+struct Stream {
+  std::vector<uint8_t> bytes;
+  size_t sof_height_offset;
+  size_t scan_offset;
+  // offset of every RST marker in the scan
+  std::vector<size_t> markers;
+};
+
+void append_segment(std::vector<uint8_t> *out, uint8_t marker, const std::vector<uint8_t> &payload) {
+  const size_t len = payload.size() + 2;
+  out->insert(out->end(), {0xFF, marker, static_cast<uint8_t>(len >> 8), static_cast<uint8_t>(len & 0xFF)});
+  out->insert(out->end(), payload.begin(), payload.end());
+}
+
+// Baseline 4:2:0 frame (16x16 MCUs), one restart interval of `restart_interval` MCUs or no DRI when 0. Every
+// interval's scan data is a few bytes tagged with its index, and every other one contains a stuffed 0xFF.
+Stream make_stream(uint16_t width, uint16_t height, uint16_t restart_interval, uint8_t sof_marker = MARKER_SOF0) {
+  Stream stream;
+  std::vector<uint8_t> &out = stream.bytes;
+  out = {0xFF, MARKER_SOI};
+  append_segment(&out, 0xE0, {'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0});
+  append_segment(&out, 0xDB, std::vector<uint8_t>(65, 1));
+  stream.sof_height_offset = out.size() + 5;
+  append_segment(&out, sof_marker,
+                 {8, static_cast<uint8_t>(height >> 8), static_cast<uint8_t>(height & 0xFF),
+                  static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width & 0xFF), 3, 1, 0x22, 0, 2, 0x11, 1, 3,
+                  0x11, 1});
+  if (restart_interval != 0) {
+    append_segment(&out, MARKER_DRI,
+                   {static_cast<uint8_t>(restart_interval >> 8), static_cast<uint8_t>(restart_interval & 0xFF)});
+  }
+  append_segment(&out, MARKER_SOS, {3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0});
+  stream.scan_offset = out.size();
+
+  const uint32_t mcus = ((width + 15) / 16) * ((height + 15) / 16);
+  const uint32_t intervals = restart_interval == 0 ? 1 : (mcus + restart_interval - 1) / restart_interval;
+  for (uint32_t interval = 0; interval < intervals; interval++) {
+    if (interval > 0) {
+      stream.markers.push_back(out.size());
+      out.insert(out.end(), {0xFF, static_cast<uint8_t>(MARKER_RST0 + ((interval - 1) & 7))});
+    }
+    out.insert(out.end(), {0x12, static_cast<uint8_t>(interval), 0x34});
+    if (interval % 2 == 0) {
+      out.insert(out.end(), {0xFF, 0x00});
+    }
+  }
+  out.insert(out.end(), {0xFF, MARKER_EOI});
+  return stream;
+}
+
+uint16_t frame_height(const std::vector<uint8_t> &bytes, size_t sof_height_offset) {
+  return read_be16(bytes.data() + sof_height_offset);
+}
+
+std::vector<uint8_t> rst_markers(const std::vector<uint8_t> &bytes, size_t scan_offset) {
+  std::vector<uint8_t> markers;
+  for (size_t i = scan_offset; i + 1 < bytes.size(); i++) {
+    if (is_rst_marker(bytes.data() + i)) {
+      markers.push_back(bytes[i + 1] - MARKER_RST0);
+      i++;
+    }
+  }
+  return markers;
+}
+
+TEST(JpegLayoutTest, ParsesHeaders) {
+  const Stream stream = make_stream(176, 144, 11);
+  JpegLayout layout;
+  ASSERT_TRUE(parse_jpeg_layout(stream.bytes.data(), stream.bytes.size(), &layout));
+  EXPECT_EQ(layout.width, 176);
+  EXPECT_EQ(layout.height, 144);
+  EXPECT_EQ(layout.mcu_width, 16);
+  EXPECT_EQ(layout.mcu_height, 16);
+  EXPECT_EQ(layout.restart_interval, 11);
+  EXPECT_EQ(layout.sof_height_offset, stream.sof_height_offset);
+  EXPECT_EQ(layout.scan_offset, stream.scan_offset);
+}
+
+TEST(JpegLayoutTest, RejectsProgressiveAndTruncatedStreams) {
+  JpegLayout layout;
+  const Stream progressive = make_stream(176, 144, 11, MARKER_SOF2);
+  EXPECT_FALSE(parse_jpeg_layout(progressive.bytes.data(), progressive.bytes.size(), &layout));
+
+  const Stream stream = make_stream(176, 144, 11);
+  // cut inside the SOF segment
+  EXPECT_FALSE(parse_jpeg_layout(stream.bytes.data(), stream.sof_height_offset + 2, &layout));
+  const std::vector<uint8_t> not_jpeg = {0x89, 'P', 'N', 'G'};
+  EXPECT_FALSE(parse_jpeg_layout(not_jpeg.data(), not_jpeg.size(), &layout));
+}
+
+TEST(JpegLayoutTest, NoRestartIntervalFallsBackToOneDecoder) {
+  const Stream stream = make_stream(176, 144, 0);
+  JpegLayout layout;
+  ASSERT_TRUE(parse_jpeg_layout(stream.bytes.data(), stream.bytes.size(), &layout));
+  EXPECT_EQ(layout.restart_interval, 0);
+  JpegSplit split;
+  EXPECT_FALSE(plan_jpeg_split(stream.bytes.data(), stream.bytes.size(), layout, &split));
+  EXPECT_EQ(split.split_row, 0u);
+}
+
+TEST(JpegLayoutTest, IntervalOffRowBoundariesFallsBackToOneDecoder) {
+  // 11 MCUs per row, 9 rows; an interval of 7 only meets a row start at row 7, 63 MCUs in, which is kept
+  const Stream kept = make_stream(176, 144, 7);
+  JpegLayout layout;
+  ASSERT_TRUE(parse_jpeg_layout(kept.bytes.data(), kept.bytes.size(), &layout));
+  JpegSplit split;
+  ASSERT_TRUE(plan_jpeg_split(kept.bytes.data(), kept.bytes.size(), layout, &split));
+  EXPECT_EQ(split.split_row, 7u);
+
+  // an interval of 13 never does within 9 rows
+  const Stream none = make_stream(176, 144, 13);
+  ASSERT_TRUE(parse_jpeg_layout(none.bytes.data(), none.bytes.size(), &layout));
+  EXPECT_FALSE(plan_jpeg_split(none.bytes.data(), none.bytes.size(), layout, &split));
+  EXPECT_EQ(split.split_row, 0u);
+}
+
+TEST(JpegLayoutTest, MissingMarkerFallsBackToOneDecoder) {
+  Stream stream = make_stream(176, 144, 11);
+  // drop every marker after the first
+  stream.bytes.resize(stream.markers[1]);
+  stream.bytes.insert(stream.bytes.end(), {0xFF, MARKER_EOI});
+  JpegLayout layout;
+  ASSERT_TRUE(parse_jpeg_layout(stream.bytes.data(), stream.bytes.size(), &layout));
+  JpegSplit split;
+  EXPECT_FALSE(plan_jpeg_split(stream.bytes.data(), stream.bytes.size(), layout, &split));
+  EXPECT_NE(split.split_row, 0u);
+  EXPECT_EQ(split.split_pos, 0u);
+}
+
+struct SplitCase {
+  uint16_t width;
+  uint16_t height;
+  uint16_t restart_interval;
+  uint32_t split_row;
+};
+
+class JpegSplitTest : public testing::TestWithParam<SplitCase> {};
+
+TEST_P(JpegSplitTest, CutsAtTheMiddleRestartMarkerAndRenumbers) {
+  const SplitCase &c = GetParam();
+  const Stream stream = make_stream(c.width, c.height, c.restart_interval);
+  const std::vector<uint8_t> &data = stream.bytes;
+  JpegLayout layout;
+  ASSERT_TRUE(parse_jpeg_layout(data.data(), data.size(), &layout));
+  JpegSplit split;
+  ASSERT_TRUE(plan_jpeg_split(data.data(), data.size(), layout, &split));
+
+  const uint32_t mcus_per_row = (c.width + 15) / 16;
+  EXPECT_EQ(split.split_row, c.split_row);
+  EXPECT_EQ(split.split_marker, c.split_row * mcus_per_row / c.restart_interval);
+  ASSERT_LE(split.split_marker, stream.markers.size());
+  EXPECT_EQ(split.split_pos, stream.markers[split.split_marker - 1]);
+  EXPECT_EQ(split.top_height, c.split_row * 16);
+  EXPECT_EQ(split.top_height + split.bottom_height, c.height);
+
+  std::vector<uint8_t> top(split.top_len);
+  std::vector<uint8_t> bottom(split.bottom_len);
+  write_jpeg_halves(data.data(), data.size(), layout, split, top.data(), bottom.data());
+
+  // top: the original stream up to the marker, closed with EOI
+  EXPECT_EQ(frame_height(top, stream.sof_height_offset), split.top_height);
+  EXPECT_TRUE(std::equal(data.begin() + stream.scan_offset, data.begin() + split.split_pos,
+                         top.begin() + stream.scan_offset));
+  EXPECT_EQ(top[top.size() - 2], 0xFF);
+  EXPECT_EQ(top[top.size() - 1], MARKER_EOI);
+  const std::vector<uint8_t> top_markers = rst_markers(top, stream.scan_offset);
+  ASSERT_EQ(top_markers.size(), split.split_marker - 1);
+  for (size_t i = 0; i < top_markers.size(); i++) {
+    EXPECT_EQ(top_markers[i], i & 7);
+  }
+
+  // bottom: the same headers with its own height, then the scan after the marker with RSTn counting from 0
+  EXPECT_EQ(frame_height(bottom, stream.sof_height_offset), split.bottom_height);
+  JpegLayout bottom_layout;
+  ASSERT_TRUE(parse_jpeg_layout(bottom.data(), bottom.size(), &bottom_layout));
+  EXPECT_EQ(bottom_layout.height, split.bottom_height);
+  EXPECT_EQ(bottom_layout.scan_offset, stream.scan_offset);
+  const std::vector<uint8_t> bottom_markers = rst_markers(bottom, stream.scan_offset);
+  ASSERT_EQ(bottom_markers.size(), stream.markers.size() - split.split_marker);
+  for (size_t i = 0; i < bottom_markers.size(); i++) {
+    EXPECT_EQ(bottom_markers[i], i & 7) << "marker " << i;
+  }
+  // everything but the marker numbers is the original scan
+  std::vector<uint8_t> original(data.begin() + split.split_pos + 2, data.end());
+  std::vector<uint8_t> copied(bottom.begin() + stream.scan_offset, bottom.end());
+  for (size_t i = 0; i + 1 < original.size(); i++) {
+    if (is_rst_marker(original.data() + i)) {
+      original[i + 1] = copied[i + 1] = MARKER_RST0;
+      i++;
+    }
+  }
+  EXPECT_EQ(copied, original);
+}
+
+INSTANTIATE_TEST_SUITE_P(Frames, JpegSplitTest,
+                         testing::Values(
+                             // QCIF, one marker per MCU row
+                             SplitCase{176, 144, 11, 4},
+                             // one marker per MCU, RSTn wraps several times before the cut
+                             SplitCase{176, 144, 1, 4},
+                             // VGA, one marker per row: the bottom half starts at RST(14 & 7) and is renumbered
+                             SplitCase{640, 480, 40, 15},
+                             // a marker every other row, the middle row 4 of 9 is even
+                             SplitCase{176, 144, 22, 4},
+                             // a marker every third row, row 3 is the closest to the middle of 9
+                             SplitCase{176, 144, 33, 3}));
+
+}  // namespace
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
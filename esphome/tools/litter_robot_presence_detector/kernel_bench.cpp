@@ -0,0 +1,317 @@
+// Google Benchmark suite for the component's per-frame kernels at the model's shapes, plus the model's Conv2D,
+// MaxPool2D and FullyConnected layers on the scalar reference kernels from reference_ops.h. The input size is read
+// from the model in model_data.h and the layer shapes follow from it. The per-frame kernels run on the device with the kernel_benchmark option, which logs cycle
+// counts; TFLM ops are timed there with profile_ops.
+//
+// Build on the host:
+//   SRC=../../components/litter_robot_presence_detector
+//   g++ -std=c++17 -O2 -I$SRC kernel_bench.cpp $SRC/image_ops.cpp $SRC/frame_quality.cpp
+//       $SRC/preview_gate.cpp $SRC/cat_enrollment.cpp -lbenchmark -lpthread -o kernel_bench
+// JPEG decode per framesize is added with -DWITH_TJPGD -I$TJPGD $TJPGD/tjpgd.c (TJpgDec as shipped with esp_jpeg);
+// it decodes the file named by BENCH_JPEG at 1/1 to 1/8 scale.
+
+#include "cat_enrollment.h"
+#include "frame_quality.h"
+#include "image_ops.h"
+#include "model_data.h"
+#include "preview_gate.h"
+#include "reference_ops.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#ifdef WITH_TJPGD
+extern "C" {
+#include "tjpgd.h"
+}
+#include <cstdlib>
+#include <fstream>
+#endif
+
+using namespace esphome::litter_robot_presence_detector;
+
+namespace {
+
+struct ModelInput {
+  int height;
+  int width;
+  int channels;
+};
+
+uint32_t read_u32(const unsigned char *p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24; }
+
+// the table or vector an offset field at `pos` points to
+size_t follow(const unsigned char *data, size_t pos) { return pos + read_u32(data + pos); }
+
+// position of field `index` of the flatbuffer table at `table`, 0 when the field is absent
+size_t table_field(const unsigned char *data, size_t table, int index) {
+  const size_t vtable = table - (int32_t) read_u32(data + table);
+  const size_t vtable_size = data[vtable] | data[vtable + 1] << 8;
+  if (4 + 2 * (size_t) index >= vtable_size) {
+    return 0;
+  }
+  const size_t offset = data[vtable + 4 + 2 * index] | data[vtable + 5 + 2 * index] << 8;
+  return offset == 0 ? 0 : table + offset;
+}
+
+// Model.subgraphs[0].tensors[inputs[0]].shape, NHWC
+ModelInput read_model_input(const unsigned char *data) {
+  const size_t model = follow(data, 0);
+  const size_t subgraphs = follow(data, table_field(data, model, 2));
+  const size_t subgraph = follow(data, subgraphs + 4);
+  const size_t inputs = follow(data, table_field(data, subgraph, 1));
+  const uint32_t input = read_u32(data + inputs + 4);
+  const size_t tensors = follow(data, table_field(data, subgraph, 0));
+  const size_t tensor = follow(data, tensors + 4 + 4 * input);
+  const size_t shape = follow(data, table_field(data, tensor, 0));
+  if (read_u32(data + shape) != 4) {
+    fprintf(stderr, "model input is not NHWC\n");
+    abort();
+  }
+  return {(int) read_u32(data + shape + 8), (int) read_u32(data + shape + 12), (int) read_u32(data + shape + 16)};
+}
+
+const ModelInput MODEL_INPUT = read_model_input(g_model_data);
+const int INPUT_WIDTH = MODEL_INPUT.width;
+const int INPUT_HEIGHT = MODEL_INPUT.height;
+const int EMBEDDING_DIM = 128;
+
+std::vector<uint8_t> random_image(int width, int height) {
+  std::mt19937 rng(42);
+  std::vector<uint8_t> image((size_t) width * height * 3);
+  for (auto &value : image) {
+    value = rng();
+  }
+  return image;
+}
+
+// framesizes the camera delivers (QCIF, QVGA, CIF, VGA), resized to the model input
+void frame_sizes(benchmark::internal::Benchmark *bench) {
+  bench->Args({176, 144})->Args({320, 240})->Args({352, 288})->Args({640, 480});
+}
+
+void BM_CropResize(benchmark::State &state) {
+  const int width = state.range(0);
+  const int height = state.range(1);
+  std::vector<uint8_t> frame = random_image(width, height);
+  std::vector<uint8_t> input((size_t) INPUT_WIDTH * INPUT_HEIGHT * 3);
+  for (auto _ : state) {
+    if (!crop_resize_rgb888(frame.data(), width, 0, 0, width, height, input.data(), INPUT_WIDTH, INPUT_HEIGHT)) {
+      state.SkipWithError("model input wider than crop_resize_rgb888 takes");
+      return;
+    }
+    benchmark::DoNotOptimize(input.data());
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_CropResize)->Apply(frame_sizes);
+
+void BM_OrientedCopy(benchmark::State &state) {
+  std::vector<uint8_t> frame = random_image(INPUT_WIDTH, INPUT_HEIGHT);
+  std::vector<uint8_t> input(frame.size());
+  OrientedCopy copy;
+  copy.set_rotation(state.range(0));
+  copy.configure(INPUT_WIDTH, INPUT_HEIGHT, INPUT_WIDTH, INPUT_HEIGHT);
+  for (auto _ : state) {
+    copy.copy(frame.data(), input.data());
+    benchmark::DoNotOptimize(input.data());
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_OrientedCopy)->Arg(0)->Arg(90)->Arg(180)->Arg(270);
+
+// the plain memcpy into the uint8 input tensor
+void BM_InputCopy(benchmark::State &state) {
+  std::vector<uint8_t> frame = random_image(INPUT_WIDTH, INPUT_HEIGHT);
+  std::vector<uint8_t> input(frame.size());
+  for (auto _ : state) {
+    memcpy(input.data(), frame.data(), frame.size());
+    benchmark::DoNotOptimize(input.data());
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_InputCopy);
+
+// copy into an int8 input tensor, what a model quantized with int8 input would need
+void BM_InputQuantizeInt8(benchmark::State &state) {
+  std::vector<uint8_t> frame = random_image(INPUT_WIDTH, INPUT_HEIGHT);
+  std::vector<int8_t> input(frame.size());
+  for (auto _ : state) {
+    for (size_t i = 0; i < frame.size(); i++) {
+      input[i] = (int8_t) (frame[i] ^ 0x80);
+    }
+    benchmark::DoNotOptimize(input.data());
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_InputQuantizeInt8);
+
+void BM_FrameQuality(benchmark::State &state) {
+  std::vector<uint8_t> frame = random_image(INPUT_WIDTH, INPUT_HEIGHT);
+  FrameQuality quality;
+  for (auto _ : state) {
+    measure_frame_quality(frame.data(), INPUT_WIDTH, INPUT_HEIGHT, &quality);
+    benchmark::DoNotOptimize(quality);
+  }
+}
+BENCHMARK(BM_FrameQuality);
+
+// QQVGA preview decoded at 1/4
+void BM_PreviewDetectChange(benchmark::State &state) {
+  std::vector<uint8_t> frame = random_image(40, 30);
+  PreviewGate gate;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(gate.detect_change(frame.data(), 40, 30));
+  }
+}
+BENCHMARK(BM_PreviewDetectChange);
+
+void BM_DotProductS16(benchmark::State &state) {
+  std::vector<uint8_t> bytes = random_image(EMBEDDING_DIM, 2);
+  // zero-point corrected embeddings, as the enrollment head sees them
+  std::vector<int16_t> values(bytes.begin(), bytes.end());
+  for (auto &v : values) {
+    v -= 128;
+  }
+  const int16_t *a = values.data();
+  const int16_t *b = a + EMBEDDING_DIM;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(dot_product_s16(a, b, EMBEDDING_DIM));
+  }
+}
+BENCHMARK(BM_DotProductS16);
+
+int same_output(int size, int stride) { return (size + stride - 1) / stride; }
+
+int same_padding(int size, int filter, int stride) {
+  return std::max(0, (same_output(size, stride) - 1) * stride + filter - size) / 2;
+}
+
+ConvGeometry same_conv(int height, int width, int depth, int filter, int stride, int output_depth) {
+  return {height,
+          width,
+          depth,
+          filter,
+          filter,
+          stride,
+          1,
+          same_padding(height, filter, stride),
+          same_padding(width, filter, stride),
+          same_output(height, stride),
+          same_output(width, stride),
+          output_depth};
+}
+
+// the model's layers, SAME padding throughout: Conv2D 5x5/3 -> 25, MaxPool 3x3/2, Conv2D 5x5/2 -> 30, MaxPool 2x2/2
+const ConvGeometry CONV1 = same_conv(INPUT_HEIGHT, INPUT_WIDTH, MODEL_INPUT.channels, 5, 3, 25);
+const int POOL1_HEIGHT = same_output(CONV1.output_height, 2);
+const int POOL1_WIDTH = same_output(CONV1.output_width, 2);
+const ConvGeometry CONV2 = same_conv(POOL1_HEIGHT, POOL1_WIDTH, 25, 5, 2, 30);
+const ConvGeometry MODEL_CONVS[] = {CONV1, CONV2};
+
+void BM_Conv2D(benchmark::State &state) {
+  const ConvGeometry &g = MODEL_CONVS[state.range(0)];
+  std::vector<uint8_t> input = random_image(g.input_width * g.input_depth, g.input_height);
+  std::vector<uint8_t> filter = random_image(g.filter_width * g.filter_height * g.input_depth, g.output_depth);
+  std::vector<int32_t> bias(g.output_depth, 1000);
+  std::vector<int32_t> multiplier(g.output_depth, 1 << 30);
+  std::vector<int32_t> shift(g.output_depth, -8);
+  std::vector<int8_t> output((size_t) g.output_height * g.output_width * g.output_depth);
+  for (auto _ : state) {
+    reference_conv_s8(g, (const int8_t *) input.data(), (const int8_t *) filter.data(), bias.data(), multiplier.data(),
+                      shift.data(), 128, -128, output.data());
+    benchmark::DoNotOptimize(output.data());
+  }
+  state.counters["MACs"] = benchmark::Counter((double) output.size() * g.filter_height * g.filter_width * g.input_depth,
+                                              benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(BM_Conv2D)->Arg(0)->Arg(1);
+
+// after each Conv2D: 3x3/2 and 2x2/2, SAME padding
+void BM_MaxPool2D(benchmark::State &state) {
+  struct Pool {
+    int height, width, depth, filter_size;
+  };
+  static const Pool POOLS[] = {{CONV1.output_height, CONV1.output_width, 25, 3},
+                               {CONV2.output_height, CONV2.output_width, 30, 2}};
+  const Pool &p = POOLS[state.range(0)];
+  const int output_height = same_output(p.height, 2);
+  const int output_width = same_output(p.width, 2);
+  std::vector<uint8_t> input = random_image(p.width * p.depth, p.height);
+  std::vector<int8_t> output((size_t) output_height * output_width * p.depth);
+  for (auto _ : state) {
+    reference_max_pool_s8((const int8_t *) input.data(), p.height, p.width, p.depth, p.filter_size, 2,
+                          same_padding(p.height, p.filter_size, 2), same_padding(p.width, p.filter_size, 2),
+                          output_height, output_width, output.data());
+    benchmark::DoNotOptimize(output.data());
+  }
+}
+BENCHMARK(BM_MaxPool2D)->Arg(0)->Arg(1);
+
+// the classifier head, 30 pooled features -> 3 classes
+void BM_FullyConnected(benchmark::State &state) {
+  std::vector<uint8_t> input = random_image(30, 1);
+  std::vector<uint8_t> filter = random_image(30, 3);
+  std::vector<int32_t> bias(3, 1000);
+  int8_t output[3];
+  for (auto _ : state) {
+    reference_fully_connected_s8((const int8_t *) input.data(), 30, (const int8_t *) filter.data(), bias.data(), 3,
+                                 1 << 30, -8, 128, -128, output);
+    benchmark::DoNotOptimize(output);
+  }
+}
+BENCHMARK(BM_FullyConnected);
+
+#ifdef WITH_TJPGD
+struct JpegSource {
+  const std::vector<uint8_t> *data;
+  size_t pos;
+};
+
+size_t jpeg_input(JDEC *jd, uint8_t *buf, size_t len) {
+  auto *source = static_cast<JpegSource *>(jd->device);
+  len = std::min(len, source->data->size() - source->pos);
+  if (buf != nullptr) {
+    memcpy(buf, source->data->data() + source->pos, len);
+  }
+  source->pos += len;
+  return len;
+}
+
+int jpeg_output(JDEC *jd, void *bitmap, JRECT *rect) {
+  benchmark::DoNotOptimize(bitmap);
+  return 1;
+}
+
+void BM_JpegDecode(benchmark::State &state) {
+  const char *path = getenv("BENCH_JPEG");
+  std::ifstream file(path != nullptr ? path : "", std::ios::binary);
+  if (!file) {
+    state.SkipWithError("set BENCH_JPEG to a frame captured by the camera");
+    return;
+  }
+  std::vector<uint8_t> jpeg((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  static uint8_t pool[32 * 1024];
+  for (auto _ : state) {
+    JDEC jd;
+    JpegSource source{&jpeg, 0};
+    if (jd_prepare(&jd, jpeg_input, pool, sizeof(pool), &source) != JDR_OK ||
+        jd_decomp(&jd, jpeg_output, state.range(0)) != JDR_OK) {
+      state.SkipWithError("decode failed");
+      return;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * jpeg.size());
+}
+BENCHMARK(BM_JpegDecode)->DenseRange(0, 3);
+#endif
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,157 @@
+// Checks that argmax_only publishes what the Softmax would have: the passthrough graph copies raw int8 logits into
+// the Softmax output and the output Quantize converts them as if they were probabilities, then logits_to_scores()
+// rebuilds the scores. The Softmax path is modelled as float softmax rounded into its int8 output (scale 1/256,
+// zero point -128) and quantized to the uint8 model output, which is where TFLM's int8 Softmax lands within a step.
+// The encodings are the ones of the model in model_data.h.
+//
+// Build and run on the host:
+//   SRC=../../components/litter_robot_presence_detector
+//   g++ -std=c++17 -O2 -I$SRC logit_scores_test.cpp -lgtest -lgtest_main -lpthread -o logit_scores_test
+//   ./logit_scores_test
+
+#include "logit_scores.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+namespace {
+
+const LogitsEncoding MODEL_ENCODING = {{0.16239450871944427f, 9}, {1.0f / 256, -128}, {1.0f / 256, 0}};
+
+uint8_t quantize_op(int8_t value, const LogitsEncoding &encoding) {
+  const float real = (value - encoding.softmax.zero_point) * encoding.softmax.scale;
+  const int32_t q = static_cast<int32_t>(lroundf(real / encoding.output.scale)) + encoding.output.zero_point;
+  return static_cast<uint8_t>(std::min(255, std::max(0, q)));
+}
+
+std::vector<uint8_t> softmax_path(const std::vector<int8_t> &logits, const LogitsEncoding &encoding) {
+  std::vector<float> values(logits.size());
+  for (size_t i = 0; i < logits.size(); i++) {
+    values[i] = (logits[i] - encoding.logits.zero_point) * encoding.logits.scale;
+  }
+  const float max_value = *std::max_element(values.begin(), values.end());
+  float sum = 0.0f;
+  for (float &value : values) {
+    value = expf(value - max_value);
+    sum += value;
+  }
+  std::vector<uint8_t> scores(logits.size());
+  for (size_t i = 0; i < logits.size(); i++) {
+    const int32_t q = static_cast<int32_t>(lroundf(values[i] / sum / encoding.softmax.scale)) +
+                      encoding.softmax.zero_point;
+    scores[i] = quantize_op(static_cast<int8_t>(std::min(127, std::max(-128, q))), encoding);
+  }
+  return scores;
+}
+
+std::vector<uint8_t> passthrough_path(const std::vector<int8_t> &logits, const LogitsEncoding &encoding) {
+  std::vector<uint8_t> output(logits.size());
+  for (size_t i = 0; i < logits.size(); i++) {
+    output[i] = quantize_op(logits[i], encoding);
+  }
+  std::vector<uint8_t> scores(logits.size());
+  EXPECT_TRUE(logits_to_scores(output.data(), output.size(), encoding, scores.data()));
+  return scores;
+}
+
+// index of the first maximum and top-1 minus top-2, as get_prediction_result() computes them
+void argmax_margin(const std::vector<uint8_t> &scores, int *index, int *margin) {
+  *index = static_cast<int>(std::max_element(scores.begin(), scores.end()) - scores.begin());
+  int runner_up = 0;
+  for (size_t i = 0; i < scores.size(); i++) {
+    if (static_cast<int>(i) != *index) {
+      runner_up = std::max<int>(runner_up, scores[i]);
+    }
+  }
+  *margin = scores[*index] - runner_up;
+}
+
+void expect_matches_softmax(const std::vector<int8_t> &logits, const LogitsEncoding &encoding) {
+  const std::vector<uint8_t> expected = softmax_path(logits, encoding);
+  const std::vector<uint8_t> actual = passthrough_path(logits, encoding);
+  int expected_index, expected_margin, actual_index, actual_margin;
+  argmax_margin(expected, &expected_index, &expected_margin);
+  argmax_margin(actual, &actual_index, &actual_margin);
+  for (size_t i = 0; i < logits.size(); i++) {
+    EXPECT_NEAR(actual[i], expected[i], 1) << "class " << i;
+  }
+  // a near tie may round either way in both paths
+  if (expected_margin > 1) {
+    EXPECT_EQ(actual_index, expected_index);
+  }
+  EXPECT_NEAR(actual_margin, expected_margin, 2);
+}
+
+TEST(LogitScoresTest, MatchesSoftmaxOnRandomLogits) {
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<int> value(-128, 127);
+  for (int trial = 0; trial < 2000; trial++) {
+    std::vector<int8_t> logits(3);
+    for (int8_t &logit : logits) {
+      logit = static_cast<int8_t>(value(rng));
+    }
+    SCOPED_TRACE(trial);
+    expect_matches_softmax(logits, MODEL_ENCODING);
+  }
+}
+
+TEST(LogitScoresTest, MatchesSoftmaxWithoutOutputQuantize) {
+  // uint8 logits copied straight into a uint8 Softmax output that is the model output
+  const LogitsEncoding encoding = {{0.1f, 120}, {1.0f / 256, 0}, {1.0f / 256, 0}};
+  std::mt19937 rng(11);
+  std::uniform_int_distribution<int> value(0, 255);
+  for (int trial = 0; trial < 500; trial++) {
+    std::vector<uint8_t> logits(4);
+    std::vector<float> values(logits.size());
+    for (size_t i = 0; i < logits.size(); i++) {
+      logits[i] = static_cast<uint8_t>(value(rng));
+      values[i] = (logits[i] - encoding.logits.zero_point) * encoding.logits.scale;
+    }
+    const float max_value = *std::max_element(values.begin(), values.end());
+    float sum = 0.0f;
+    for (float &v : values) {
+      v = expf(v - max_value);
+      sum += v;
+    }
+    std::vector<uint8_t> expected(logits.size());
+    for (size_t i = 0; i < logits.size(); i++) {
+      expected[i] = static_cast<uint8_t>(std::min(255L, lroundf(values[i] / sum / encoding.output.scale)));
+    }
+    std::vector<uint8_t> actual(logits.size());
+    ASSERT_TRUE(logits_to_scores(logits.data(), logits.size(), encoding, actual.data()));
+    SCOPED_TRACE(trial);
+    EXPECT_EQ(actual, expected);
+  }
+}
+
+TEST(LogitScoresTest, SoftmaxEncodingMisreadsMargins) {
+  // what argmax_only published before: the Quantize output of raw logits, read as probabilities
+  const std::vector<int8_t> logits = {40, 20, -60};
+  std::vector<uint8_t> raw(logits.size());
+  for (size_t i = 0; i < logits.size(); i++) {
+    raw[i] = quantize_op(logits[i], MODEL_ENCODING);
+  }
+  int raw_index, raw_margin, expected_index, expected_margin;
+  argmax_margin(raw, &raw_index, &raw_margin);
+  argmax_margin(softmax_path(logits, MODEL_ENCODING), &expected_index, &expected_margin);
+  EXPECT_EQ(raw_index, expected_index);
+  EXPECT_NE(raw_margin, expected_margin);
+  EXPECT_EQ(passthrough_path(logits, MODEL_ENCODING), softmax_path(logits, MODEL_ENCODING));
+}
+
+TEST(LogitScoresTest, RejectsTooManyClasses) {
+  std::vector<uint8_t> output(MAX_LOGITS + 1, 0);
+  EXPECT_FALSE(logits_to_scores(output.data(), output.size(), MODEL_ENCODING, output.data()));
+  EXPECT_FALSE(logits_to_scores(output.data(), 0, MODEL_ENCODING, output.data()));
+}
+
+}  // namespace
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
@@ -0,0 +1,116 @@
+// Scalar int8 Conv2D, FullyConnected and MaxPool2D with the arithmetic of TFLM's reference kernels
+// (reference_integer_ops ConvPerChannel, FullyConnected and MaxPool), for host tools that check or time the
+// component's kernels without a tflite-micro build. ESP-NN matches these bit for bit.
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+namespace esphome {
+namespace litter_robot_presence_detector {
+
+inline int32_t multiply_by_quantized_multiplier(int32_t x, int32_t multiplier, int shift) {
+  const int left_shift = shift > 0 ? shift : 0;
+  const int right_shift = shift > 0 ? 0 : -shift;
+  const int64_t product = static_cast<int64_t>(x * (1 << left_shift)) * multiplier;
+  const int32_t high = static_cast<int32_t>((product + (int64_t(1) << 30)) >> 31);
+  if (right_shift == 0) {
+    return high;
+  }
+  const int32_t mask = (1 << right_shift) - 1;
+  const int32_t remainder = high & mask;
+  const int32_t threshold = (mask >> 1) + (high < 0 ? 1 : 0);
+  return (high >> right_shift) + (remainder > threshold ? 1 : 0);
+}
+
+inline int8_t requantize_s8(int32_t acc, int32_t multiplier, int shift, int32_t output_offset) {
+  acc = multiply_by_quantized_multiplier(acc, multiplier, shift) + output_offset;
+  return static_cast<int8_t>(std::min<int32_t>(127, std::max<int32_t>(-128, acc)));
+}
+
+// NHWC input, OHWI filter; output rows [0, output_height) read input rows from -pad_top
+struct ConvGeometry {
+  int input_height;
+  int input_width;
+  int input_depth;
+  int filter_height;
+  int filter_width;
+  int stride;
+  int dilation;
+  int pad_top;
+  int pad_left;
+  int output_height;
+  int output_width;
+  int output_depth;
+};
+
+inline void reference_conv_s8(const ConvGeometry &g, const int8_t *input, const int8_t *filter, const int32_t *bias,
+                              const int32_t *multiplier, const int32_t *shift, int32_t input_offset,
+                              int32_t output_offset, int8_t *output) {
+  for (int out_y = 0; out_y < g.output_height; out_y++) {
+    for (int out_x = 0; out_x < g.output_width; out_x++) {
+      for (int out_c = 0; out_c < g.output_depth; out_c++) {
+        int32_t acc = bias[out_c];
+        for (int fy = 0; fy < g.filter_height; fy++) {
+          const int in_y = out_y * g.stride - g.pad_top + fy * g.dilation;
+          if (in_y < 0 || in_y >= g.input_height) {
+            continue;
+          }
+          for (int fx = 0; fx < g.filter_width; fx++) {
+            const int in_x = out_x * g.stride - g.pad_left + fx * g.dilation;
+            if (in_x < 0 || in_x >= g.input_width) {
+              continue;
+            }
+            const int8_t *pixel = input + (in_y * g.input_width + in_x) * g.input_depth;
+            const int8_t *taps = filter + ((out_c * g.filter_height + fy) * g.filter_width + fx) * g.input_depth;
+            for (int c = 0; c < g.input_depth; c++) {
+              acc += (pixel[c] + input_offset) * taps[c];
+            }
+          }
+        }
+        output[(out_y * g.output_width + out_x) * g.output_depth + out_c] =
+            requantize_s8(acc, multiplier[out_c], shift[out_c], output_offset);
+      }
+    }
+  }
+}
+
+inline void reference_fully_connected_s8(const int8_t *input, int input_depth, const int8_t *filter,
+                                         const int32_t *bias, int output_depth, int32_t multiplier, int shift,
+                                         int32_t input_offset, int32_t output_offset, int8_t *output) {
+  for (int out_c = 0; out_c < output_depth; out_c++) {
+    int32_t acc = bias[out_c];
+    const int8_t *weights = filter + out_c * input_depth;
+    for (int c = 0; c < input_depth; c++) {
+      acc += (input[c] + input_offset) * weights[c];
+    }
+    output[out_c] = requantize_s8(acc, multiplier, shift, output_offset);
+  }
+}
+
+// padding taps are skipped, as in the reference MaxPool
+inline void reference_max_pool_s8(const int8_t *input, int input_height, int input_width, int depth, int filter_size,
+                                  int stride, int pad_top, int pad_left, int output_height, int output_width,
+                                  int8_t *output) {
+  for (int out_y = 0; out_y < output_height; out_y++) {
+    const int y_begin = std::max(0, out_y * stride - pad_top);
+    const int y_end = std::min(input_height, out_y * stride - pad_top + filter_size);
+    for (int out_x = 0; out_x < output_width; out_x++) {
+      const int x_begin = std::max(0, out_x * stride - pad_left);
+      const int x_end = std::min(input_width, out_x * stride - pad_left + filter_size);
+      int8_t *out = output + (out_y * output_width + out_x) * depth;
+      for (int c = 0; c < depth; c++) {
+        int8_t max = -128;
+        for (int y = y_begin; y < y_end; y++) {
+          for (int x = x_begin; x < x_end; x++) {
+            max = std::max(max, input[(y * input_width + x) * depth + c]);
+          }
+        }
+        out[c] = max;
+      }
+    }
+  }
+}
+
+}  // namespace litter_robot_presence_detector
+}  // namespace esphome
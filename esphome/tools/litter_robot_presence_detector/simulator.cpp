@@ -0,0 +1,288 @@
+// Discrete-event simulator of the litter_robot_presence_detector loop() on a virtual clock.
+//
+// Replays a labelled scenario through a simulated camera (latency + jitter), the 30 ms wait_for_image_() retry,
+// modelled decode/Invoke costs and the component's StateSmoother, and reports per policy how long decisions take,
+// how busy the CPU is and how many visits were never reported.
+//
+// Build on the host:
+//   SRC=../../components/litter_robot_presence_detector
+//   g++ -std=c++17 -O2 -I$SRC simulator.cpp $SRC/state_smoother.cpp -o simulator
+//
+// Scenario file, one segment per line, '#' starts a comment:
+//   <class> <seconds>      e.g. "0 600" = empty box for 10 minutes, "1 45" = nachi visits for 45 s
+//
+// Usage:
+//   simulator scenario.txt [--camera-latency MS] [--jitter MS] [--timeout MS] [--decode MS] [--invoke MS]
+//             [--cost-jitter MS] [--error RATE] [--seed N] [--policy interval=MS,sma=N|ema=ALPHA] ...
+// Without --policy the production settings (loop every 16 ms, 7-frame SMA) and a 0.2 EMA are compared.
+
+#include "state_smoother.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using esphome::litter_robot_presence_detector::SmoothingMode;
+using esphome::litter_robot_presence_detector::StateSmoother;
+
+namespace {
+
+const size_t NUM_CLASSES = 3;
+// ESPHome calls loop() about every 16 ms when nothing else is due
+const double LOOP_INTERVAL_MS = 16.0;
+
+struct Segment {
+  int label;
+  double start_ms;
+  double end_ms;
+};
+
+struct CameraModel {
+  double latency_ms{120.0};
+  double jitter_ms{40.0};
+  double timeout_ms{30.0};  // xSemaphoreTake() in wait_for_image_()
+};
+
+struct CostModel {
+  double decode_ms{60.0};
+  double invoke_ms{450.0};
+  double jitter_ms{20.0};
+  double error_rate{0.1};  // share of frames the model gets wrong
+};
+
+struct Policy {
+  std::string name;
+  double interval_ms{0.0};  // extra idle time after each processed frame
+  SmoothingMode mode{SmoothingMode::SMA};
+  size_t window{7};
+  double alpha{0.2};
+};
+
+struct Report {
+  uint32_t frames{0};
+  uint32_t timeouts{0};
+  uint32_t visits{0};
+  uint32_t missed_visits{0};
+  uint32_t flips{0};  // decision changes that do not match a segment boundary
+  double busy_ms{0.0};
+  double total_ms{0.0};
+  std::vector<double> entry_latency_ms;
+  std::vector<double> exit_latency_ms;
+};
+
+bool load_scenario(const char *path, std::vector<Segment> *segments) {
+  std::ifstream file(path);
+  if (!file) {
+    fprintf(stderr, "can not open %s\n", path);
+    return false;
+  }
+  std::string line;
+  double start_ms = 0.0;
+  while (std::getline(file, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream fields(line);
+    int label;
+    double seconds;
+    if (!(fields >> label >> seconds)) {
+      continue;
+    }
+    if (label < 0 || label >= (int) NUM_CLASSES || seconds <= 0) {
+      fprintf(stderr, "bad segment '%s'\n", line.c_str());
+      return false;
+    }
+    segments->push_back({label, start_ms, start_ms + seconds * 1000.0});
+    start_ms += seconds * 1000.0;
+  }
+  return !segments->empty();
+}
+
+bool parse_policy(const std::string &spec, Policy *policy) {
+  policy->name = spec;
+  std::istringstream items(spec);
+  std::string item;
+  while (std::getline(items, item, ',')) {
+    size_t eq = item.find('=');
+    if (eq == std::string::npos) {
+      return false;
+    }
+    std::string key = item.substr(0, eq);
+    double value = atof(item.c_str() + eq + 1);
+    if (key == "interval") {
+      policy->interval_ms = value;
+    } else if (key == "sma") {
+      policy->mode = SmoothingMode::SMA;
+      policy->window = std::max<size_t>(1, (size_t) value);
+    } else if (key == "ema") {
+      policy->mode = SmoothingMode::EMA;
+      policy->alpha = value;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+int label_at(const std::vector<Segment> &segments, double t) {
+  for (const auto &segment : segments) {
+    if (t < segment.end_ms) {
+      return segment.label;
+    }
+  }
+  return segments.back().label;
+}
+
+Report simulate(const std::vector<Segment> &segments, const CameraModel &camera, const CostModel &costs,
+                const Policy &policy, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> unit(0.0, 1.0);
+  std::uniform_real_distribution<double> chance(0.0, 1.0);
+  auto jittered = [&](double mean, double jitter) { return std::max(0.0, mean + jitter * unit(rng)); };
+
+  StateSmoother smoother;
+  smoother.setup(NUM_CLASSES, policy.mode, policy.window, policy.alpha);
+
+  Report report;
+  const double end_ms = segments.back().end_ms;
+  double now = 0.0;
+  double pending_arrival = -1.0;  // a requested frame still on its way
+  int decision = 0;
+  size_t segment_index = 0;
+  bool reported = segments[0].label == 0;  // the current segment's label has been published
+
+  while (now < end_ms) {
+    // request_image(); a frame that arrived after the last timeout is picked up without waiting
+    if (pending_arrival < 0) {
+      pending_arrival = now + jittered(camera.latency_ms, camera.jitter_ms);
+    }
+    if (pending_arrival > now + camera.timeout_ms) {
+      report.timeouts++;
+      now += camera.timeout_ms + LOOP_INTERVAL_MS;
+      continue;
+    }
+    double captured = std::max(now, pending_arrival);
+    now = captured;
+    pending_arrival = -1.0;
+
+    double cost = jittered(costs.decode_ms + costs.invoke_ms, costs.jitter_ms);
+    now += cost;
+    report.busy_ms += cost;
+    report.frames++;
+
+    int truth = label_at(segments, captured);
+    int prediction = truth;
+    if (chance(rng) < costs.error_rate) {
+      prediction = (truth + 1 + (int) (chance(rng) * (NUM_CLASSES - 1))) % NUM_CLASSES;
+    }
+    int next = smoother.update(prediction);
+
+    // attribute the decision time to the segment it happened in
+    while (segment_index + 1 < segments.size() && now >= segments[segment_index].end_ms) {
+      const Segment &finished = segments[segment_index];
+      if (finished.label != 0) {
+        report.visits++;
+        report.missed_visits += reported ? 0 : 1;
+      }
+      segment_index++;
+      reported = false;
+    }
+    const Segment &current = segments[segment_index];
+    if (next != decision) {
+      decision = next;
+      if (decision == current.label && !reported) {
+        double latency = now - current.start_ms;
+        (current.label == 0 ? report.exit_latency_ms : report.entry_latency_ms).push_back(latency);
+      } else if (reported || decision != current.label) {
+        report.flips++;
+      }
+    }
+    reported = reported || decision == current.label;
+
+    now += policy.interval_ms + LOOP_INTERVAL_MS;
+  }
+  if (segments.back().label != 0) {
+    report.visits++;
+    report.missed_visits += reported ? 0 : 1;
+  }
+  report.total_ms = now;
+  return report;
+}
+
+double percentile(std::vector<double> values, double p) {
+  if (values.empty()) {
+    return 0.0;
+  }
+  std::sort(values.begin(), values.end());
+  return values[std::min(values.size() - 1, (size_t) (p * values.size()))];
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s scenario.txt [options], see the top of simulator.cpp\n", argv[0]);
+    return 1;
+  }
+  CameraModel camera;
+  CostModel costs;
+  uint32_t seed = 1;
+  std::vector<Policy> policies;
+  for (int i = 2; i + 1 < argc; i += 2) {
+    const char *option = argv[i];
+    const char *value = argv[i + 1];
+    if (strcmp(option, "--camera-latency") == 0) {
+      camera.latency_ms = atof(value);
+    } else if (strcmp(option, "--jitter") == 0) {
+      camera.jitter_ms = atof(value);
+    } else if (strcmp(option, "--timeout") == 0) {
+      camera.timeout_ms = atof(value);
+    } else if (strcmp(option, "--decode") == 0) {
+      costs.decode_ms = atof(value);
+    } else if (strcmp(option, "--invoke") == 0) {
+      costs.invoke_ms = atof(value);
+    } else if (strcmp(option, "--cost-jitter") == 0) {
+      costs.jitter_ms = atof(value);
+    } else if (strcmp(option, "--error") == 0) {
+      costs.error_rate = atof(value);
+    } else if (strcmp(option, "--seed") == 0) {
+      seed = strtoul(value, nullptr, 10);
+    } else if (strcmp(option, "--policy") == 0) {
+      Policy policy;
+      if (!parse_policy(value, &policy)) {
+        fprintf(stderr, "bad policy '%s'\n", value);
+        return 1;
+      }
+      policies.push_back(policy);
+    } else {
+      fprintf(stderr, "unknown option %s\n", option);
+      return 1;
+    }
+  }
+  if (policies.empty()) {
+    Policy sma, ema;
+    parse_policy("interval=0,sma=7", &sma);
+    parse_policy("interval=0,ema=0.2", &ema);
+    policies = {sma, ema};
+  }
+
+  std::vector<Segment> segments;
+  if (!load_scenario(argv[1], &segments)) {
+    return 1;
+  }
+
+  printf("%-28s %7s %8s %6s %7s %6s %10s %10s %10s %10s\n", "policy", "frames", "timeouts", "duty%", "visits",
+         "missed", "entry p50", "entry p90", "exit p50", "exit p90");
+  for (const auto &policy : policies) {
+    Report report = simulate(segments, camera, costs, policy, seed);
+    printf("%-28s %7u %8u %6.1f %7u %6u %9.0fms %9.0fms %9.0fms %9.0fms  flips=%u\n", policy.name.c_str(),
+           report.frames, report.timeouts, 100.0 * report.busy_ms / report.total_ms, report.visits,
+           report.missed_visits, percentile(report.entry_latency_ms, 0.5), percentile(report.entry_latency_ms, 0.9),
+           percentile(report.exit_latency_ms, 0.5), percentile(report.exit_latency_ms, 0.9), report.flips);
+  }
+  return 0;
+}
@@ -0,0 +1,205 @@
+// Replays recorded per-frame scores through the component's StateSmoother to compare smoothing policies.
+//
+// Build on the host:
+//   SRC=../../components/litter_robot_presence_detector
+//   g++ -std=c++17 -O2 -I$SRC smoothing_eval.cpp $SRC/state_smoother.cpp -o smoothing_eval
+//
+// Recording, one frame per line, '#' starts a comment:
+//   <timestamp ms>,<true class>,<score 0>,<score 1>,...
+// The true class marks the visit boundaries; scores are the model output as logged by get_prediction_result().
+//
+// Usage:
+//   smoothing_eval recording.csv [sma=N|ema=ALPHA] ...
+// Without policies SMA windows 3, 5, 7, 9 and EMA alphas 0.1, 0.2, 0.3 are compared.
+
+#include "state_smoother.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using esphome::litter_robot_presence_detector::SmoothingMode;
+using esphome::litter_robot_presence_detector::StateSmoother;
+
+namespace {
+
+struct Frame {
+  double timestamp_ms;
+  int label;
+  int prediction;  // argmax of the recorded scores
+};
+
+struct Policy {
+  std::string name;
+  SmoothingMode mode;
+  size_t window{7};
+  double alpha{0.2};
+};
+
+// Time and frames from a change of the true class until the smoothed decision follows it.
+struct Transition {
+  bool entry;  // empty -> cat, otherwise cat -> empty or cat -> other cat
+  double latency_ms;
+  uint32_t frames;
+};
+
+struct Report {
+  std::vector<Transition> transitions;
+  uint32_t undetected{0};  // segments that ended before the decision caught up
+  uint32_t false_flips{0};  // decision changes to a class that is not the true one
+};
+
+bool load_recording(const char *path, std::vector<Frame> *frames, size_t *num_classes) {
+  std::ifstream file(path);
+  if (!file) {
+    fprintf(stderr, "can not open %s\n", path);
+    return false;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    line = line.substr(0, line.find('#'));
+    if (line.find_first_not_of(" \t\r") == std::string::npos) {
+      continue;
+    }
+    std::vector<double> fields;
+    std::istringstream items(line);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+      fields.push_back(atof(item.c_str()));
+    }
+    if (fields.size() < 4) {
+      fprintf(stderr, "need timestamp, class and at least two scores: '%s'\n", line.c_str());
+      return false;
+    }
+    size_t classes = fields.size() - 2;
+    if (*num_classes != 0 && classes != *num_classes) {
+      fprintf(stderr, "expected %zu scores: '%s'\n", *num_classes, line.c_str());
+      return false;
+    }
+    *num_classes = classes;
+    int label = (int) fields[1];
+    if (label < 0 || label >= (int) classes) {
+      fprintf(stderr, "class out of range: '%s'\n", line.c_str());
+      return false;
+    }
+    int prediction = std::max_element(fields.begin() + 2, fields.end()) - (fields.begin() + 2);
+    frames->push_back({fields[0], label, prediction});
+  }
+  return !frames->empty();
+}
+
+bool parse_policy(const std::string &spec, Policy *policy) {
+  policy->name = spec;
+  size_t eq = spec.find('=');
+  if (eq == std::string::npos) {
+    return false;
+  }
+  std::string key = spec.substr(0, eq);
+  double value = atof(spec.c_str() + eq + 1);
+  if (key == "sma" && value >= 1) {
+    policy->mode = SmoothingMode::SMA;
+    policy->window = (size_t) value;
+    return true;
+  }
+  if (key == "ema" && value > 0 && value <= 1) {
+    policy->mode = SmoothingMode::EMA;
+    policy->alpha = value;
+    return true;
+  }
+  return false;
+}
+
+Report evaluate(const std::vector<Frame> &frames, size_t num_classes, const Policy &policy) {
+  StateSmoother smoother;
+  smoother.setup(num_classes, policy.mode, policy.window, policy.alpha);
+
+  Report report;
+  int decision = 0;
+  int label = 0;
+  size_t change_index = 0;
+  bool caught_up = true;
+  for (size_t i = 0; i < frames.size(); i++) {
+    const Frame &frame = frames[i];
+    if (frame.label != label) {
+      report.undetected += caught_up ? 0 : 1;
+      caught_up = decision == frame.label;
+      label = frame.label;
+      change_index = i;
+    }
+
+    int next = smoother.update(frame.prediction);
+    if (next == decision) {
+      continue;
+    }
+    decision = next;
+    if (decision != label) {
+      report.false_flips++;
+    } else if (!caught_up) {
+      caught_up = true;
+      const Frame &change = frames[change_index];
+      report.transitions.push_back({frames[change_index > 0 ? change_index - 1 : 0].label == 0 && label != 0,
+                                    frame.timestamp_ms - change.timestamp_ms, (uint32_t) (i - change_index + 1)});
+    }
+  }
+  report.undetected += caught_up ? 0 : 1;
+  return report;
+}
+
+double median(std::vector<double> values) {
+  if (values.empty()) {
+    return 0.0;
+  }
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s recording.csv [sma=N|ema=ALPHA] ...\n", argv[0]);
+    return 1;
+  }
+  std::vector<Policy> policies;
+  for (int i = 2; i < argc; i++) {
+    Policy policy;
+    if (!parse_policy(argv[i], &policy)) {
+      fprintf(stderr, "bad policy '%s'\n", argv[i]);
+      return 1;
+    }
+    policies.push_back(policy);
+  }
+  if (policies.empty()) {
+    for (const char *spec : {"sma=3", "sma=5", "sma=7", "sma=9", "ema=0.1", "ema=0.2", "ema=0.3"}) {
+      Policy policy;
+      parse_policy(spec, &policy);
+      policies.push_back(policy);
+    }
+  }
+
+  std::vector<Frame> frames;
+  size_t num_classes = 0;
+  if (!load_recording(argv[1], &frames, &num_classes)) {
+    return 1;
+  }
+  double hours = (frames.back().timestamp_ms - frames.front().timestamp_ms) / 3600000.0;
+
+  printf("%-10s %12s %12s %13s %13s %10s %11s\n", "policy", "entry ms", "exit ms", "entry frames", "exit frames",
+         "undetected", "flips/hour");
+  for (const auto &policy : policies) {
+    Report report = evaluate(frames, num_classes, policy);
+    std::vector<double> entry_ms, exit_ms, entry_frames, exit_frames;
+    for (const auto &transition : report.transitions) {
+      (transition.entry ? entry_ms : exit_ms).push_back(transition.latency_ms);
+      (transition.entry ? entry_frames : exit_frames).push_back(transition.frames);
+    }
+    printf("%-10s %12.0f %12.0f %13.1f %13.1f %10u %11.2f\n", policy.name.c_str(), median(entry_ms), median(exit_ms),
+           median(entry_frames), median(exit_frames), report.undetected,
+           hours > 0 ? report.false_flips / hours : 0.0);
+  }
+  return 0;
+}
@@ -0,0 +1,176 @@
+// Google Benchmark of the block-sparse Conv2D (sparse_conv option) against the dense scalar reference it replaces,
+// across sparsity levels. Both run the same requantization, and every case first checks the sparse output is
+// bit-exact with the dense one. The sparse side is the kernel from sparse_blocks.h that sparse_conv.cpp runs per
+// output pixel; the dense side is the scalar reference Conv2D from reference_ops.h. The break-even found here is
+// against scalar code, not ESP-NN's SIMD conv that dense layers run on the device, which is why sparse_max_density
+// defaults well below it.
+//
+// Filters are pruned either in whole blocks of 4 input channels (structured, what the offline pruning should
+// produce) or weight by weight (unstructured, where a block only drops out once all 4 of its weights are zero).
+//
+// Build and run on the host:
+//   SRC=../../components/litter_robot_presence_detector
+//   g++ -std=c++17 -O2 -I$SRC sparse_bench.cpp -lbenchmark -lpthread -o sparse_bench && ./sparse_bench
+
+#include "reference_ops.h"
+#include "sparse_blocks.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace esphome::litter_robot_presence_detector;
+
+namespace {
+
+struct Geometry {
+  int input_height;
+  int input_width;
+  int input_depth;
+  int filter_size;
+  int output_depth;
+};
+
+// 3x3 SAME stride 1 layers at 176x144 / 2, 4 and 8 with depths that take 4-channel blocks; the Conv2D layers of the
+// model in model_data.h have 3 and 25 input channels and fall back to single-weight blocks
+const Geometry LAYERS[] = {{72, 88, 8, 3, 16}, {36, 44, 16, 3, 32}, {18, 22, 32, 3, 64}};
+
+const int32_t INPUT_OFFSET = 128;
+const int32_t OUTPUT_OFFSET = -5;
+
+struct Layer {
+  Geometry geometry;
+  int pad;
+  std::vector<int8_t> input;
+  std::vector<int8_t> filter;
+  std::vector<int32_t> bias;
+  std::vector<int32_t> multiplier;
+  std::vector<int32_t> shift;
+  std::vector<SparseBlock> blocks;
+  std::vector<uint32_t> channel_start;
+  SparseFilter sparse;
+};
+
+ConvGeometry conv_geometry(const Layer &layer) {
+  const Geometry &g = layer.geometry;
+  return {g.input_height, g.input_width, g.input_depth,  g.filter_size, g.filter_size, 1,
+          1,              layer.pad,     layer.pad,      g.input_height, g.input_width, g.output_depth};
+}
+
+void dense_conv(const Layer &layer, int8_t *output) {
+  reference_conv_s8(conv_geometry(layer), layer.input.data(), layer.filter.data(), layer.bias.data(),
+                    layer.multiplier.data(), layer.shift.data(), INPUT_OFFSET, OUTPUT_OFFSET, output);
+}
+
+void sparse_conv(const Layer &layer, int8_t *output) {
+  const Geometry &g = layer.geometry;
+  const int channel_stride = g.filter_size * g.filter_size * g.input_depth;
+  for (int out_y = 0; out_y < g.input_height; out_y++) {
+    for (int out_x = 0; out_x < g.input_width; out_x++) {
+      for (int out_c = 0; out_c < g.output_depth; out_c++) {
+        int32_t acc = sparse_accumulate(layer.sparse, out_c, layer.filter.data() + out_c * channel_stride,
+                                        g.filter_size, layer.input.data(), g.input_height, g.input_width,
+                                        g.input_depth, out_y - layer.pad, out_x - layer.pad, 1, 1, INPUT_OFFSET);
+        output[(out_y * g.input_width + out_x) * g.output_depth + out_c] =
+            requantize_s8(acc + layer.bias[out_c], layer.multiplier[out_c], layer.shift[out_c], OUTPUT_OFFSET);
+      }
+    }
+  }
+}
+
+// sparsity_percent of the blocks (structured) or weights (unstructured) are zero
+Layer make_layer(const Geometry &g, int sparsity_percent, bool structured) {
+  Layer layer;
+  layer.geometry = g;
+  layer.pad = (g.filter_size - 1) / 2;
+
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> byte(-128, 127);
+  std::uniform_int_distribution<int> percent(0, 99);
+  layer.input.resize(g.input_height * g.input_width * g.input_depth);
+  for (auto &v : layer.input) {
+    v = byte(rng);
+  }
+  layer.filter.resize(g.output_depth * g.filter_size * g.filter_size * g.input_depth);
+  const int block_size = sparse_block_size(g.input_depth);
+  const int prune_size = structured ? block_size : 1;
+  for (size_t offset = 0; offset < layer.filter.size(); offset += prune_size) {
+    const bool pruned = percent(rng) < sparsity_percent;
+    for (int i = 0; i < prune_size; i++) {
+      // pruning leaves no zeros behind in the weights it keeps
+      int value = byte(rng);
+      layer.filter[offset + i] = pruned ? 0 : (value == 0 ? 1 : value);
+    }
+  }
+  std::uniform_int_distribution<int32_t> bias(-20000, 20000);
+  std::uniform_int_distribution<int32_t> multiplier(1 << 30, INT32_MAX);
+  std::uniform_int_distribution<int> shift(-12, -6);
+  for (int c = 0; c < g.output_depth; c++) {
+    layer.bias.push_back(bias(rng));
+    layer.multiplier.push_back(multiplier(rng));
+    layer.shift.push_back(shift(rng));
+  }
+
+  const uint32_t non_zero = count_sparse_blocks(layer.filter.data(), layer.filter.size(), block_size);
+  layer.blocks.resize(std::max<uint32_t>(non_zero, 1));
+  layer.channel_start.resize(g.output_depth + 1);
+  build_sparse_blocks(layer.filter.data(), g.output_depth, g.filter_size, g.filter_size, g.input_depth, block_size,
+                      layer.blocks.data(), layer.channel_start.data());
+  layer.sparse = {layer.blocks.data(), layer.channel_start.data(), block_size};
+  return layer;
+}
+
+// Args: layer index, sparsity percent, structured
+void sparse_args(benchmark::internal::Benchmark *bench) {
+  for (int layer = 0; layer < 3; layer++) {
+    for (int sparsity : {0, 50, 75, 90}) {
+      bench->Args({layer, sparsity, 1});
+    }
+    bench->Args({layer, 75, 0});
+  }
+}
+
+void report(benchmark::State &state, const Layer &layer) {
+  const Geometry &g = layer.geometry;
+  const double total_blocks = (double) layer.filter.size() / layer.sparse.block_size;
+  state.counters["block_density"] = layer.sparse.channel_start[g.output_depth] / total_blocks;
+  state.counters["MACs"] = benchmark::Counter((double) g.input_height * g.input_width * layer.filter.size(),
+                                              benchmark::Counter::kIsIterationInvariantRate);
+}
+
+void BM_DenseConv(benchmark::State &state) {
+  const Layer layer = make_layer(LAYERS[state.range(0)], state.range(1), state.range(2) != 0);
+  const Geometry &g = layer.geometry;
+  std::vector<int8_t> output((size_t) g.input_height * g.input_width * g.output_depth);
+  for (auto _ : state) {
+    dense_conv(layer, output.data());
+    benchmark::DoNotOptimize(output.data());
+  }
+  report(state, layer);
+}
+BENCHMARK(BM_DenseConv)->Apply(sparse_args)->Unit(benchmark::kMicrosecond);
+
+void BM_SparseConv(benchmark::State &state) {
+  const Layer layer = make_layer(LAYERS[state.range(0)], state.range(1), state.range(2) != 0);
+  const Geometry &g = layer.geometry;
+  std::vector<int8_t> dense((size_t) g.input_height * g.input_width * g.output_depth);
+  std::vector<int8_t> output(dense.size());
+  dense_conv(layer, dense.data());
+  sparse_conv(layer, output.data());
+  if (output != dense) {
+    state.SkipWithError("sparse output differs from dense");
+    return;
+  }
+  for (auto _ : state) {
+    sparse_conv(layer, output.data());
+    benchmark::DoNotOptimize(output.data());
+  }
+  report(state, layer);
+}
+BENCHMARK(BM_SparseConv)->Apply(sparse_args)->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,364 @@
+// Sweeps decode scale, region of interest, channel count and model variant over a labelled JPEG dataset and prints
+// accuracy against per-frame latency, arena and flash size, marking the Pareto-optimal configurations.
+//
+// Frames go through the same decoder (TJpgDec, which esp_jpeg wraps, with the same 1/1..1/8 scaling), the same
+// crop/resize as the component and TFLM's reference kernels, so accuracy matches the device; latency is host time
+// and only meaningful relative to the other rows.
+//
+// Build on the host against a tflite-micro checkout (make -f tensorflow/lite/micro/tools/make/Makefile microlite)
+// and the TJpgDec sources shipped with esp_jpeg (idf-extra-components/esp_jpeg/tjpgd, JD_FORMAT 0 = RGB888):
+//   SRC=../../components/litter_robot_presence_detector
+//   DL=$TFLM/tensorflow/lite/micro/tools/make/downloads
+//   g++ -std=c++17 -O2 -DTF_LITE_STATIC_MEMORY -I$SRC -I$TJPGD -I$TFLM -I$DL/flatbuffers/include
+//       -I$DL/gemmlowp sweep.cpp $SRC/image_ops.cpp $TJPGD/tjpgd.c $TFLM/gen/linux_x86_64_default/lib/*.a -o sweep
+//
+// Dataset list, one frame per line, paths relative to the list:
+//   <true class> <file.jpg>
+//
+// Usage:
+//   sweep dataset.txt --model a.tflite [--model b.tflite ...] [--scales 0,1,2,3] [--channels 3,1]
+//         [--roi x,y,width,height ...]
+// Scales are powers of two the decoder divides by; ROIs are in percent of the frame, the full frame is always swept.
+
+#include "image_ops.h"
+
+extern "C" {
+#include "tjpgd.h"
+}
+
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using esphome::litter_robot_presence_detector::crop_resize_rgb888;
+
+namespace {
+
+const size_t ARENA_SIZE = 1024 * 1024;
+const size_t DECODER_POOL_SIZE = 32 * 1024;
+
+struct Sample {
+  int label;
+  std::vector<uint8_t> jpeg;
+};
+
+struct Roi {
+  int x, y, width, height;  // percent
+};
+
+struct Config {
+  std::string model;
+  int scale;
+  Roi roi;
+  int channels;
+};
+
+struct Result {
+  Config config;
+  double accuracy;
+  double latency_ms;
+  size_t arena_bytes;
+  size_t flash_bytes;
+  bool pareto;
+};
+
+struct DecodeTarget {
+  const std::vector<uint8_t> *jpeg;
+  size_t read_pos;
+  std::vector<uint8_t> *rgb;
+  int width;
+};
+
+bool read_file(const std::string &path, std::vector<uint8_t> *data) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    fprintf(stderr, "can not open %s\n", path.c_str());
+    return false;
+  }
+  data->assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  return true;
+}
+
+size_t decoder_input(JDEC *jd, uint8_t *buf, size_t len) {
+  auto *target = static_cast<DecodeTarget *>(jd->device);
+  len = std::min(len, target->jpeg->size() - target->read_pos);
+  if (buf != nullptr) {
+    memcpy(buf, target->jpeg->data() + target->read_pos, len);
+  }
+  target->read_pos += len;
+  return len;
+}
+
+int decoder_output(JDEC *jd, void *bitmap, JRECT *rect) {
+  auto *target = static_cast<DecodeTarget *>(jd->device);
+  const uint8_t *src = static_cast<const uint8_t *>(bitmap);
+  const int rect_width = rect->right - rect->left + 1;
+  for (int y = rect->top; y <= rect->bottom; y++) {
+    memcpy(target->rgb->data() + ((size_t) y * target->width + rect->left) * 3, src, rect_width * 3);
+    src += rect_width * 3;
+  }
+  return 1;
+}
+
+// Decodes at 1 / 2^scale, like esp_jpeg's JPEG_IMAGE_SCALE_* options.
+bool decode(const std::vector<uint8_t> &jpeg, int scale, std::vector<uint8_t> *rgb, int *width, int *height) {
+  static uint8_t pool[DECODER_POOL_SIZE];
+  JDEC jd;
+  DecodeTarget target{&jpeg, 0, rgb, 0};
+  if (jd_prepare(&jd, decoder_input, pool, sizeof(pool), &target) != JDR_OK) {
+    return false;
+  }
+  *width = jd.width >> scale;
+  *height = jd.height >> scale;
+  target.width = *width;
+  rgb->resize((size_t) *width * *height * 3);
+  return jd_decomp(&jd, decoder_output, scale) == JDR_OK;
+}
+
+void to_grayscale(std::vector<uint8_t> *rgb) {
+  for (size_t i = 0; i + 2 < rgb->size(); i += 3) {
+    uint8_t luma = ((*rgb)[i] * 77 + (*rgb)[i + 1] * 150 + (*rgb)[i + 2] * 29) >> 8;
+    (*rgb)[i] = (*rgb)[i + 1] = (*rgb)[i + 2] = luma;
+  }
+}
+
+// same op list as LitterRobotPresenceDetector::register_preprocessor_ops()
+bool register_ops(tflite::MicroMutableOpResolver<13> *resolver) {
+  return resolver->AddConv2D() == kTfLiteOk && resolver->AddQuantize() == kTfLiteOk &&
+         resolver->AddLeakyRelu() == kTfLiteOk && resolver->AddMaxPool2D() == kTfLiteOk &&
+         resolver->AddFullyConnected() == kTfLiteOk && resolver->AddReshape() == kTfLiteOk &&
+         resolver->AddSoftmax() == kTfLiteOk && resolver->AddMean() == kTfLiteOk &&
+         resolver->AddDepthwiseConv2D() == kTfLiteOk && resolver->AddAdd() == kTfLiteOk &&
+         resolver->AddPad() == kTfLiteOk && resolver->AddRelu6() == kTfLiteOk &&
+         resolver->AddAveragePool2D() == kTfLiteOk;
+}
+
+bool fill_input(const std::vector<uint8_t> &rgb, int frame_width, int frame_height, const Config &config,
+                TfLiteTensor *input, std::vector<uint8_t> *scratch) {
+  const int input_height = input->dims->data[1];
+  const int input_width = input->dims->data[2];
+  const int input_channels = input->dims->data[3];
+  int x = frame_width * config.roi.x / 100;
+  int y = frame_height * config.roi.y / 100;
+  int width = std::max(1, frame_width * config.roi.width / 100);
+  int height = std::max(1, frame_height * config.roi.height / 100);
+  scratch->resize((size_t) input_width * input_height * 3);
+  if (!crop_resize_rgb888(rgb.data(), frame_width, x, y, width, height, scratch->data(), input_width, input_height)) {
+    fprintf(stderr, "input width %d is more than crop_resize_rgb888 takes\n", input_width);
+    return false;
+  }
+  if (config.channels == 1) {
+    to_grayscale(scratch);
+  }
+
+  if (input->type != kTfLiteUInt8 && input->type != kTfLiteInt8) {
+    fprintf(stderr, "unsupported input type %d\n", input->type);
+    return false;
+  }
+
+  // the component's input copy moves the RGB bytes unchanged whatever the input type, so an int8 input gets them
+  // unshifted here too; a single channel model gets the luma plane
+  const size_t pixels = (size_t) input_width * input_height;
+  for (size_t i = 0; i < pixels; i++) {
+    for (int c = 0; c < input_channels; c++) {
+      input->data.uint8[i * input_channels + c] = (*scratch)[i * 3 + (input_channels == 1 ? 0 : c)];
+    }
+  }
+  return true;
+}
+
+// scores compare as uint8, like get_prediction_result()
+int argmax(const TfLiteTensor *output) {
+  const int num_classes = output->dims->data[output->dims->size - 1];
+  const uint8_t *scores = output->data.uint8;
+  int best = 0;
+  for (int i = 1; i < num_classes; i++) {
+    if (scores[i] > scores[best]) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+bool run_model(const std::string &model_path, const std::vector<Config> &configs, const std::vector<Sample> &samples,
+               std::vector<Result> *results) {
+  std::vector<uint8_t> model_data;
+  if (!read_file(model_path, &model_data)) {
+    return false;
+  }
+  const tflite::Model *model = tflite::GetModel(model_data.data());
+  if (model->version() != TFLITE_SCHEMA_VERSION) {
+    fprintf(stderr, "%s: schema version %d\n", model_path.c_str(), (int) model->version());
+    return false;
+  }
+  static tflite::MicroMutableOpResolver<13> resolver;
+  static bool registered = register_ops(&resolver);
+  if (!registered) {
+    fprintf(stderr, "registering ops failed\n");
+    return false;
+  }
+  static std::vector<uint8_t> arena(ARENA_SIZE);
+  tflite::MicroInterpreter interpreter(model, resolver, arena.data(), arena.size());
+  if (interpreter.AllocateTensors() != kTfLiteOk) {
+    fprintf(stderr, "%s: AllocateTensors() failed\n", model_path.c_str());
+    return false;
+  }
+  TfLiteTensor *input = interpreter.input(0);
+
+  std::vector<uint8_t> rgb, scratch;
+  for (const auto &config : configs) {
+    if (config.model != model_path) {
+      continue;
+    }
+    uint32_t correct = 0;
+    double total_ms = 0.0;
+    for (const auto &sample : samples) {
+      auto start = std::chrono::steady_clock::now();
+      int width, height;
+      if (!decode(sample.jpeg, config.scale, &rgb, &width, &height) ||
+          !fill_input(rgb, width, height, config, input, &scratch) || interpreter.Invoke() != kTfLiteOk) {
+        return false;
+      }
+      total_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      correct += argmax(interpreter.output(0)) == sample.label ? 1 : 0;
+    }
+    results->push_back({config, (double) correct / samples.size(), total_ms / samples.size(),
+                        interpreter.arena_used_bytes(), model_data.size(), false});
+  }
+  return true;
+}
+
+void mark_pareto(std::vector<Result> *results) {
+  for (auto &candidate : *results) {
+    candidate.pareto = true;
+    for (const auto &other : *results) {
+      bool no_worse = other.accuracy >= candidate.accuracy && other.latency_ms <= candidate.latency_ms &&
+                      other.arena_bytes <= candidate.arena_bytes && other.flash_bytes <= candidate.flash_bytes;
+      bool better = other.accuracy > candidate.accuracy || other.latency_ms < candidate.latency_ms ||
+                    other.arena_bytes < candidate.arena_bytes || other.flash_bytes < candidate.flash_bytes;
+      if (no_worse && better) {
+        candidate.pareto = false;
+        break;
+      }
+    }
+  }
+}
+
+std::vector<int> parse_list(const char *value) {
+  std::vector<int> values;
+  std::istringstream items(value);
+  std::string item;
+  while (std::getline(items, item, ',')) {
+    values.push_back(atoi(item.c_str()));
+  }
+  return values;
+}
+
+bool load_dataset(const std::string &list_path, std::vector<Sample> *samples) {
+  std::ifstream list(list_path);
+  if (!list) {
+    fprintf(stderr, "can not open %s\n", list_path.c_str());
+    return false;
+  }
+  std::string dir = list_path.substr(0, list_path.find_last_of('/') + 1);
+  std::string line;
+  while (std::getline(list, line)) {
+    std::istringstream fields(line);
+    Sample sample;
+    std::string file;
+    if (!(fields >> sample.label >> file)) {
+      continue;
+    }
+    if (!read_file(file[0] == '/' ? file : dir + file, &sample.jpeg)) {
+      return false;
+    }
+    samples->push_back(std::move(sample));
+  }
+  return !samples->empty();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s dataset.txt --model a.tflite ..., see the top of sweep.cpp\n", argv[0]);
+    return 1;
+  }
+  std::vector<std::string> models;
+  std::vector<int> scales = {0, 1, 2, 3};
+  std::vector<int> channels = {3};
+  std::vector<Roi> rois = {{0, 0, 100, 100}};
+  for (int i = 2; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--model") == 0) {
+      models.push_back(argv[i + 1]);
+    } else if (strcmp(argv[i], "--scales") == 0) {
+      scales = parse_list(argv[i + 1]);
+    } else if (strcmp(argv[i], "--channels") == 0) {
+      channels = parse_list(argv[i + 1]);
+    } else if (strcmp(argv[i], "--roi") == 0) {
+      std::vector<int> roi = parse_list(argv[i + 1]);
+      if (roi.size() != 4 || roi[0] + roi[2] > 100 || roi[1] + roi[3] > 100) {
+        fprintf(stderr, "bad roi '%s'\n", argv[i + 1]);
+        return 1;
+      }
+      rois.push_back({roi[0], roi[1], roi[2], roi[3]});
+    } else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (models.empty()) {
+    fprintf(stderr, "at least one --model is needed\n");
+    return 1;
+  }
+
+  std::vector<Sample> samples;
+  if (!load_dataset(argv[1], &samples)) {
+    return 1;
+  }
+
+  std::vector<Config> configs;
+  for (const auto &model : models) {
+    for (int scale : scales) {
+      for (const auto &roi : rois) {
+        for (int channel_count : channels) {
+          configs.push_back({model, scale, roi, channel_count});
+        }
+      }
+    }
+  }
+
+  std::vector<Result> results;
+  for (const auto &model : models) {
+    if (!run_model(model, configs, samples, &results)) {
+      return 1;
+    }
+  }
+  mark_pareto(&results);
+  std::sort(results.begin(), results.end(),
+            [](const Result &a, const Result &b) { return a.latency_ms < b.latency_ms; });
+
+  printf("%zu frames\n", samples.size());
+  printf("  %-32s %5s %-15s %8s %9s %10s %10s %10s\n", "model", "scale", "roi", "channels", "accuracy", "latency",
+         "arena", "flash");
+  for (const auto &result : results) {
+    char roi[24];
+    snprintf(roi, sizeof(roi), "%d,%d,%d,%d", result.config.roi.x, result.config.roi.y, result.config.roi.width,
+             result.config.roi.height);
+    printf("%c %-32s %4s%d %-15s %8d %8.1f%% %8.2fms %10zu %10zu\n", result.pareto ? '*' : ' ',
+           result.config.model.c_str(), "1/", 1 << result.config.scale, roi, result.config.channels,
+           100.0 * result.accuracy, result.latency_ms, result.arena_bytes, result.flash_bytes);
+  }
+  printf("* = Pareto optimal over accuracy, latency, arena and flash\n");
+  return 0;
+}